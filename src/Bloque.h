@@ -4,6 +4,7 @@
 
 #include "dist/bloqdist.hpp"
 #include "Matriz.hpp"
+#include "types.h"
 
 // Clase "wrapper" para aislar el GHT de la estructura de bloques
 template <typename T>
@@ -12,26 +13,46 @@ class Bloque
 	// Matriz a la que pertenece el bloque
 	const Matriz<T> *mat;
 
-	// Identificador del bloque dentro de la matriz
-	size_t _id;
+	// Identificador del bloque dentro de la matriz. Con 32 bits el bloque ocupa
+	// lo mismo que un puntero y un entero, y los nodos del GHT quedan compactos.
+	U32 _id;
+
+	// Resumen del contenido del bloque, para descartar bloques lejanos sin compararlos
+	dist::resumen<T> _resumen;
 
 public:
 
 	Bloque() {}
-	Bloque(const Matriz<T> *m, size_t bloqid) : _id(bloqid), mat(m) {}
+	Bloque(const Matriz<T> *m, size_t bloqid, const dist::resumen<T> &r) : mat(m), _id(bloqid), _resumen(r) {}
 
-	size_t id() { return _id; }
+	size_t id() const { return _id; }
 
 	// Distancia entre bloques
 	double operator-(const Bloque &b) const {
 		return dist::bloqdist(*mat, _id, b._id);
 	}
 
+	// Distancia entre bloques, exacta solo si no supera el limite (ver dist::bloqdist_acotada).
+	// Antes de comparar los bloques se prueba con la cota que dan sus resumenes.
+	double dist_acotada(const Bloque &b, double limite) const {
+		double cota = _resumen.cota(b._resumen);
+		if (cota > limite) return cota;
+		return dist::bloqdist_acotada(*mat, _id, b._id, limite);
+	}
+
 	Bloque& operator=(const Bloque &b) {
 		mat = b.mat;
 		_id = b._id;
+		_resumen = b._resumen;
 		return *this;
 	}
 };
 
+// Distancia acotada para el GHT, que la encuentra por ADL
+template <typename T>
+double distancia_acotada(const Bloque<T> &a, const Bloque<T> &b, double limite)
+{
+	return a.dist_acotada(b, limite);
+}
+
 #endif
@@ -1,6 +1,11 @@
 #ifndef _MATRIZ_H
 #define _MATRIZ_H
 
+#include <algorithm>
+
+/*! Etiqueta para construir una Matriz teselada (ver el constructor que la recibe) */
+struct en_bloques {};
+
 template <typename T>
 class Matriz
 {
@@ -13,9 +18,22 @@ class Matriz
 	/*! Tabla que contiene el offset al inicio de cada bloque */
 	unsigned *_bloqTab;
 
+	/*! Distancia entre el inicio de dos filas consecutivas de un bloque */
+	int _paso;
+
+	/*! Cierto si los pixels de cada bloque estan contiguos, en un buffer propio */
+	bool _teselada;
+
 	typedef T&			reference;
 	typedef const T&	const_reference;
 
+	/*! Posicion en _data del pixel (i,j) de la matriz */
+	size_t posicion(int i, int j) const
+	{
+		if (!_teselada) return (size_t) i*_M + j;
+		return _bloqTab[(i / _p) * (_M / _q) + j / _q] + (i % _p) * _q + j % _q;
+	}
+
 public:
 
 	/*! Construye una matriz de N filas y M columnas con bloques de p filas y q columnas.
@@ -23,7 +41,8 @@ public:
 	 *
 	 *	\param data Buffer que representa la matriz de forma contigua en memoria
 	 */
-	Matriz(T *data, int N, int M, int p, int q) : _M(M), _N(N), _p(p), _q(q), _data(data)
+	Matriz(T *data, int N, int M, int p, int q) : _M(M), _N(N), _p(p), _q(q), _data(data), _paso(M),
+		_teselada(false)
 	{
 		int ncb = M / q; // Numero de columnas de bloques
 		int nfb = N / p; // Numero de filas de bloques
@@ -38,6 +57,33 @@ public:
 		}
 	}
 
+	/*! Construye una matriz teselada: como la anterior, pero con una copia de data en la que
+	 *	cada bloque ocupa p*q posiciones contiguas, fila a fila, y los bloques van en el mismo
+	 *	orden. Asi las filas de un bloque se recorren seguidas en vez de a saltos de M. La
+	 *	copia se hace en una sola pasada por data, y solo guarda los pixels de los bloques.
+	 *	Pre: NM mod pq = 0.
+	 *
+	 *	\param data Buffer que representa la matriz de forma contigua en memoria
+	 */
+	Matriz(const T *data, int N, int M, int p, int q, en_bloques) : _M(M), _N(N), _p(p), _q(q), _paso(q),
+		_teselada(true)
+	{
+		int ncb = M / q; // Numero de columnas de bloques
+		int nfb = N / p; // Numero de filas de bloques
+
+		_size = nfb * ncb;
+
+		_bloqTab = new unsigned[_size];
+		for (size_t k = 0; k < _size; ++k) _bloqTab[k] = k * p * q;
+
+		_data = new T[_size * p * q];
+		for (int i = 0; i < nfb * p; ++i) {
+			const T *fila = data + (size_t) i * M;
+			T *dst = _data + (size_t) (i / p) * ncb * p * q + (i % p) * q;
+			for (int j = 0; j < ncb; ++j, fila += q, dst += p * q) std::copy(fila, fila + q, dst);
+		}
+	}
+
 	/*! Pre: bloque pertenece al rango [0..size()-1]
 	 *
 	 *	\param j	Columna
@@ -46,7 +92,7 @@ public:
 	 */
 	const_reference operator()(int bloque, int i, int j) const
 	{
-		return _data[_bloqTab[bloque] + i*_M + j];
+		return _data[_bloqTab[bloque] + i*_paso + j];
 	}
 
 	/*! Pre: bloque pertenece al rango [0..size()-1]
@@ -57,7 +103,7 @@ public:
 	 */
 	reference operator()(int bloque, int i, int j)
 	{
-		return _data[_bloqTab[bloque] + i*_M + j];
+		return _data[_bloqTab[bloque] + i*_paso + j];
 	}
 
 	/*! Pre: bloque pertenece al rango [0..size()-1]
@@ -68,7 +114,7 @@ public:
 	 */
 	const_reference operator()(int i, int j) const
 	{
-		return _data[i*_M + j];
+		return _data[posicion(i, j)];
 	}
 
 	/*! Pre: bloque pertenece al rango [0..size()-1]
@@ -79,7 +125,7 @@ public:
 	 */
 	reference operator()(int i, int j)
 	{
-		return _data[i*_M + j];
+		return _data[posicion(i, j)];
 	}
 
 	/*! \return Numero de bloques de la matriz */
@@ -91,7 +137,21 @@ public:
 	inline int p() const { return _p; }
 	inline int q() const { return _q; }
 
-	~Matriz() { delete[] _bloqTab; }
+	/*! \return Distancia entre el inicio de dos filas consecutivas de un bloque: M, o q si la
+	 *	matriz esta teselada */
+	inline int paso() const { return _paso; }
+	inline bool teselada() const { return _teselada; }
+
+	~Matriz()
+	{
+		delete[] _bloqTab;
+		if (_teselada) delete[] _data;
+	}
+
+	/*! La matriz es duena de la tabla de bloques, y si esta teselada tambien de la copia de
+	 *	los pixels, asi que no se puede copiar */
+	Matriz(const Matriz&) = delete;
+	Matriz& operator=(const Matriz&) = delete;
 };
 
 #endif  // _MATRIZ_H_
@@ -0,0 +1,94 @@
+
+#ifndef _EQUIPO_H_
+#define _EQUIPO_H_
+
+#include "compr/compr.h"
+#include "types.h"
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+COMPRESSION_NAMESPACE_BEGIN
+
+
+// Grupo de hilos que ejecutan juntos una tarea, una tras otra. Los hilos se crean una sola vez
+// y esperan entre tarea y tarea, asi que encargar muchas tareas cortas sale barato. El hilo que
+// encarga la tarea hace tambien su parte.
+class Equipo
+{
+	std::vector<std::thread> hilos;
+
+	std::mutex mtx;
+	std::condition_variable empezar, terminar;
+
+	// Tarea en curso, numero de tareas encargadas y hilos que aun no han terminado la ultima
+	std::function<void(U32)> tarea;
+	U64 ronda;
+	U32 pendientes;
+	bool cerrar;
+
+	Equipo(const Equipo&);
+	Equipo& operator=(const Equipo&);
+
+	void trabajar(U32 k)
+	{
+		U64 vista = 0;
+		for (;;) {
+			{
+				std::unique_lock<std::mutex> l(mtx);
+				while (!cerrar && ronda == vista) empezar.wait(l);
+				if (cerrar) return;
+				vista = ronda;
+			}
+
+			tarea(k);
+
+			std::lock_guard<std::mutex> l(mtx);
+			if (--pendientes == 0) terminar.notify_one();
+		}
+	}
+
+public:
+
+	/// Crea un equipo de n hilos contando el que encarga las tareas. Pre: n > 0
+	Equipo(U32 n) : ronda(0), pendientes(0), cerrar(false)
+	{
+		for (U32 k = 1; k < n; ++k) hilos.push_back(std::thread(&Equipo::trabajar, this, k));
+	}
+
+	~Equipo()
+	{
+		{
+			std::lock_guard<std::mutex> l(mtx);
+			cerrar = true;
+		}
+		empezar.notify_all();
+		for (size_t k = 0; k < hilos.size(); ++k) hilos[k].join();
+	}
+
+	/// Numero de hilos, contando el que encarga las tareas
+	U32 size() const { return hilos.size() + 1; }
+
+	/// Ejecuta t(k) en cada hilo k del equipo, con k = 0 en este, y espera a que terminen todos.
+	void ejecutar(const std::function<void(U32)> &t)
+	{
+		{
+			std::lock_guard<std::mutex> l(mtx);
+			tarea = t;
+			pendientes = hilos.size();
+			++ronda;
+		}
+		empezar.notify_all();
+
+		t(0);
+
+		std::unique_lock<std::mutex> l(mtx);
+		while (pendientes > 0) terminar.wait(l);
+	}
+};
+
+COMPRESSION_NAMESPACE_END
+
+#endif // _EQUIPO_H_
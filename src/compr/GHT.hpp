@@ -3,6 +3,13 @@
 #define _GHT_H_
 
 #include "compr/compr.h"
+#include "compr/indices.h"
+#include "compr/Pila.hpp"
+#include "types.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
 
 COMPRESSION_NAMESPACE_BEGIN
 
@@ -13,97 +20,454 @@ COMPRESSION_NAMESPACE_BEGIN
 template <typename T>
 class GHT
 {
+	// Los nodos se guardan contiguos en un vector, en orden de entrada, y se enlazan
+	// por su posicion en el. Asi la posicion de un nodo es tambien el orden en que entro
+	// en el GHT, y el arbol se libera de una vez.
 	struct nodo {
-		nodo *der, *izq;
 		T elem;
-
-		// Este nodo fue el i-esimo que entro en el GHT
-		size_t i;
+		U32 der, izq;
 
 		nodo() {}
-		nodo(	nodo *derp, nodo *izqp, const T &elemp, size_t ip) :
-				der(derp), izq(izqp), elem(elemp), i(ip) {}
+		nodo(const T &elemp) : elem(elemp), der(nulo), izq(nulo) {}
 	};
 
-	// La raiz ficiticia para la optimizacion de guardar solo un elemento en cada nodo
-	nodo *ficticialRoot;
-	nodo *root;
+	// La posicion 0 es la de la raiz ficticia, a la que no apunta ningun nodo, asi que
+	// sirve para indicar que un hijo no existe
+	static const U32 nulo = 0;
+
+	// La raiz ficiticia para la optimizacion de guardar solo un elemento en cada nodo. La raiz
+	// real es su hijo izquierdo: el segundo elemento hasta que se reconstruye el arbol.
+	static const U32 ficticialRoot = 0;
+	static const U32 root = 1;
+
+	std::vector<nodo> nodos;
+
+	// Distancias calculadas y limite por busqueda
+	mutable esfuerzo esf;
+
+	// Profundidad del nodo mas profundo, contando la raiz real como 1
+	U32 prof;
+
+	// Se reconstruye cuando prof pasa de factor*log2(size()), si factor > 0, y el arbol ha
+	// doblado su tamano desde la ultima vez, para que el coste de reconstruir no domine
+	double factor;
+	size_t tam_reconstruido;
+	U32 nreconstrucciones;
+
+	// Tramo [ini, fin) de los nodos por colocar en la reconstruccion, que cuelgan del hijo
+	// der o izq de padre y estan a profundidad p
+	struct tramo {
+		size_t ini, fin;
+		U32 padre;
+		bool der;
+		U32 p;
+
+		tramo() {}
+		tramo(size_t i, size_t f, U32 pa, bool d, U32 pp) : ini(i), fin(f), padre(pa), der(d), p(pp) {}
+	};
+
+	// Candidatos a raiz de cada subarbol al reconstruir
+	static const size_t candidatos = 5;
+
+	// Tamano minimo para reconstruir: en un arbol pequeno no compensa
+	static const size_t min_reconstruir = 64;
+
+	static double dist(esfuerzo &e, const T &a, const T &b)
+	{
+		e.contar();
+		return a - b;
+	}
+
+	static double dist(esfuerzo &e, const T &a, const T &b, double limite)
+	{
+		e.contar();
+		return distancia_acotada(a, b, limite);
+	}
+
+	// Los huecos del rastro son los hijos que no existen: 2*nodo para el izquierdo y
+	// 2*nodo + 1 para el derecho
+	void anotar_huecos(U32 arb, rastro &h) const
+	{
+		if (nodos[arb].izq == nulo) h.anotar(2 * arb);
+		if (nodos[arb].der == nulo) h.anotar(2 * arb + 1);
+	}
 
-	size_t count;
+	// Hijo pendiente de visitar en el recorrido de busqueda. Es el hijo de un nodo cuyo otro
+	// hijo ya se ha empezado a recorrer; cuando se termine, se visitara este si no se puede
+	// descartar con el radio de busqueda que haya entonces.
+	struct pendiente {
+		U32 arb;
 
-	/*! Pre: count > 1
+		// Cierto si arb es el hijo derecho
+		bool der;
+
+		// Distancia al padre del nodo del que arb es hijo, que es con la que hay que visitar arb
+		double distpadre;
+
+		// Distancia al nodo del que arb es hijo
+		double dpq;
+
+		pendiente() {}
+		pendiente(U32 a, bool d, double dp, double q) : arb(a), der(d), distpadre(dp), dpq(q) {}
+
+		// Cierto si el subarbol puede contener algun elemento a distancia menor que r
+		bool hay_que_visitar(double r) const {
+			return der ? dpq + r > distpadre - r : dpq - r > distpadre + r;
+		}
+	};
+
+	/*! Pre: size() > 1
 	 *
 	 *	\param x		Elemento a insertar 
-	 *	\param arb		Arbol en el que insertar
-	 *	\param ant		Puntero al elemento padre de este subarbol dentro del nodo padre
+	 *	\param distx_padre	Distancia de x a la raiz ficticia
 	 */
 	// Coste log(N)*C donde N es el numero de elementos presentes en el GHT y
 	// C el coste de una comparacin de elementos
-	void insertar_rec(const T &x, nodo *&arb, double distx_padre) {
-		if (!arb) {
-			arb = new nodo(0, 0, x, count);
-		}
-		else {
-			double distIzq = arb->elem - x;
-			if (distx_padre < distIzq)	insertar_rec(x, arb->der, distx_padre);
-			else						insertar_rec(x, arb->izq, distIzq);
+	void insertar_iter(const T &x, double distx_padre) {
+		U32 arb = nodos[ficticialRoot].izq;
+
+		for (U32 p = 2;; ++p) {
+			// Si la distancia supera distx_padre solo se usa para ir a la derecha
+			double distIzq = dist(esf, nodos[arb].elem, x, distx_padre);
+			bool der = distx_padre < distIzq;
+
+			U32 hijo = der ? nodos[arb].der : nodos[arb].izq;
+			if (hijo == nulo) {
+				// Se enlaza antes de anadir el nodo, que puede mover el vector
+				(der ? nodos[arb].der : nodos[arb].izq) = nodos.size();
+				nodos.push_back(nodo(x));
+				prof = std::max(prof, p);
+				return;
+			}
+
+			if (!der) distx_padre = distIzq;
+			arb = hijo;
 		}
 	}
 
-	/*! Pre: count > 1
+	/*! Pre: size() > 1
 	 *
 	 *	\param x			Elemento a buscar 
-	 *	\param arb			Arbol en el que buscar
 	 *	\param i[out]		Indice del elemento que se retorna
 	 *  \param r[out]		Distancia al elemento mas cercano encontrado
 	 *	\param nn[out]		Elemento mas cercano a x
-	 *	\param distpadre	Distancia al nodo padre
+	 *	\param distpadre	Distancia con la que se visita arb (a la raiz ficticia si es la real)
+	 *	\param e			Donde se cuentan las distancias
+	 *	\param h			Si no es nulo, donde se anotan los huecos por los que se pasa
+	 *	\param arb			Subarbol en el que se busca
 	 */
+	// Recorre el arbol en profundidad con una pila explicita: de cada nodo se visita primero
+	// el hijo del lado de x, y el otro se deja pendiente para decidir si se poda cuando ya se
+	// haya recorrido el primero, con el radio r que haya quedado entonces.
 	// Coste lineal respecto al numero de elementos en el GHT. Es decir, en caso peor se compara x
 	// con todos los elementos del GHT.
 	// En caso medio, se hacen log(N) comparaciones.
-	const void mas_cercano_rec(const T &x, nodo *arb, int &i, double &r, T &nn, double distpadre) const {
-		if (arb) {
+	const void mas_cercano_iter(const T &x, int &i, double &r, T &nn, double distpadre,
+								esfuerzo &e, rastro *h, U32 arb) const {
+		Pila<pendiente, 64> pila;
+
+		for (;;) {
+			// Se baja por el lado de x hasta llegar a una hoja
+			while (arb != nulo) {
+				const nodo &n = nodos[arb];
+
+				// Sin hijo derecho, solo hace falta la distancia exacta si no supera r (para
+				// actualizar el mas cercano) ni distpadre + 2r (para ir a la izquierda y
+				// decidir despues si se poda el hijo izquierdo pendiente). Si no, basta con
+				// saber que es mayor, y la cota permite dejar la comparacion a medias.
+				double dpq;
+				if (n.der == nulo) {
+					double limite = n.izq == nulo ? r : std::max(r, distpadre + 2 * r);
+					dpq = dist(e, x, n.elem, limite);
+
+					// La poda se decide con otra expresion, que con el redondeo podria no
+					// coincidir con la comparacion con limite: en ese caso se calcula exacta
+					if (dpq > limite && n.izq != nulo && !(dpq - r > distpadre + r)) dpq = dist(e, x, n.elem);
+				}
+				else dpq = dist(e, x, n.elem);
+
+				if (dpq <= r) {
+					i = arb;
+					r = dpq;
+					nn = n.elem;
+				}
+				if (e.agotado()) return;
+				if (h) anotar_huecos(arb, *h);
+
+				// Los hijos que no existen no se dejan pendientes
+				if (dpq <= distpadre) {
+					if (n.der != nulo) pila.apilar(pendiente(n.der, true, distpadre, dpq));
+					arb = n.izq;
+				} else {
+					if (n.izq != nulo) pila.apilar(pendiente(n.izq, false, distpadre, dpq));
+					arb = n.der;
+				}
+				distpadre = dpq;
+			}
+
+			// Se sigue por el ultimo hijo pendiente que no se pueda podar
+			for (;;) {
+				if (pila.vacia()) return;
+
+				const pendiente &p = pila.desapilar();
+				if (p.hay_que_visitar(r)) {
+					arb = p.arb;
+					distpadre = p.distpadre;
+					break;
+				}
+			}
+		}
+	}
+
+	// Busqueda de un lote que sigue viva en un subarbol: la consulta q, la distancia con la que
+	// se visita el subarbol y, una vez visitada su raiz, la distancia a ella
+	struct activa {
+		U32 q;
+		double distpadre;
+		double dpq;
+
+		activa() {}
+		activa(U32 qp, double dp, double d = 0.0) : q(qp), distpadre(dp), dpq(d) {}
+	};
+
+	// Paso del recorrido de un lote. Visitar arb con las busquedas [ini, fin) del lote, o,
+	// una vez visitado, seguir con sus hijos: las busquedas [ini, medio) son las que van antes
+	// por la izquierda y las [medio, fin) las que van antes por la derecha.
+	enum fase { visitar, tras_izq, tras_der };
+
+	// Por debajo de este numero de busquedas, cada una sigue sola por el subarbol
+	static const size_t min_grupo = 4;
+
+	struct paso {
+		U32 arb;
+		fase f;
+		size_t ini, medio, fin;
+
+		paso() {}
+		paso(U32 a, fase fp, size_t i, size_t m, size_t f_) : arb(a), f(fp), ini(i), medio(m), fin(f_) {}
+	};
 
-			double dpq = x - arb->elem;
+	/*! Pre: size() > 1
+	 *
+	 *	\param c			Busquedas del lote, con i y r ya iniciados con la raiz ficticia
+	 *	\param lote		Busquedas que quedan por recorrer el arbol y sus distancias a la raiz ficticia
+	 *	\param evals		Distancias calculadas por cada busqueda
+	 *	\param e			Donde se cuentan las distancias
+	 */
+	// Hace el mismo recorrido que mas_cercano_iter para todas las busquedas a la vez: cada nodo
+	// se visita una sola vez con todas las busquedas que llegan a el, que despues se reparten
+	// segun el hijo por el que sigan. Las busquedas que van antes por la izquierda recorren el
+	// hijo izquierdo antes de que las demas recorran el derecho, y al reves, asi que cada una
+	// visita los mismos nodos en el mismo orden y con el mismo radio que si fuera sola.
+	void mas_cercanos_iter(consulta<T> *c, std::vector<activa> &lote, std::vector<U32> &evals,
+						   esfuerzo &e) const {
+		// Las busquedas de cada paso estan en lote y se quitan cuando se termina con el
+		Pila<paso, 64> pila;
+		pila.apilar(paso(nodos[ficticialRoot].izq, visitar, 0, 0, lote.size()));
+
+		while (!pila.vacia()) {
+			paso p = pila.desapilar();
+			lote.resize(p.fin);
+			const nodo &n = nodos[p.arb];
+
+			if (p.f == visitar && p.fin - p.ini < min_grupo) {
+				// Pocas busquedas no compensan llevar el lote, y recorren el subarbol cada una por
+				// su cuenta. Solo terminan antes de tiempo si llegan al limite, y entonces ya se
+				// ha contado la busqueda como agotada.
+				for (size_t k = p.ini; k < p.fin; ++k) {
+					const activa &a = lote[k];
+					consulta<T> &b = c[a.q];
+					T nn;
+					U64 antes = e.evaluaciones();
+					e.seguir(evals[a.q]);
+					mas_cercano_iter(b.x, b.i, b.r, nn, a.distpadre, e, b.h, p.arb);
+					evals[a.q] += e.evaluaciones() - antes;
+					if (e.maximo() && evals[a.q] >= e.maximo()) evals[a.q] = ~0u;
+				}
+			}
+			else if (p.f == visitar) {
+				for (size_t k = p.ini; k < p.fin; ++k) {
+					activa &a = lote[k];
+					consulta<T> &b = c[a.q];
+
+					// Como en mas_cercano_iter
+					if (n.der == nulo) {
+						double limite = n.izq == nulo ? b.r : std::max(b.r, a.distpadre + 2 * b.r);
+						a.dpq = dist(e, b.x, n.elem, limite);
+						++evals[a.q];
+						if (a.dpq > limite && n.izq != nulo && !(a.dpq - b.r > a.distpadre + b.r)) {
+							a.dpq = dist(e, b.x, n.elem);
+							++evals[a.q];
+						}
+					}
+					else {
+						a.dpq = dist(e, b.x, n.elem);
+						++evals[a.q];
+					}
+
+					if (a.dpq <= b.r) {
+						b.i = p.arb;
+						b.r = a.dpq;
+					}
+
+					// Las busquedas que llegan al limite se dejan, y no pasan a los hijos
+					if (e.agotado(evals[a.q])) evals[a.q] = ~0u;
+					else if (b.h) anotar_huecos(p.arb, *b.h);
+				}
+
+				// Se reparten, las que van antes por la izquierda primero
+				size_t ini = lote.size();
+				for (size_t k = p.ini; k < p.fin; ++k) {
+					if (evals[lote[k].q] != ~0u && lote[k].dpq <= lote[k].distpadre) lote.push_back(lote[k]);
+				}
+				size_t medio = lote.size();
+				for (size_t k = p.ini; k < p.fin; ++k) {
+					if (evals[lote[k].q] != ~0u && lote[k].dpq > lote[k].distpadre) lote.push_back(lote[k]);
+				}
+				size_t fin = lote.size();
+				pila.apilar(paso(p.arb, tras_izq, ini, medio, fin));
+
+				if (n.izq != nulo && medio > ini) {
+					for (size_t k = ini; k < medio; ++k) lote.push_back(activa(lote[k].q, lote[k].dpq));
+					pila.apilar(paso(n.izq, visitar, fin, fin, lote.size()));
+				}
+			}
+			else if (p.f == tras_izq) {
+				pila.apilar(paso(p.arb, tras_der, p.medio, p.medio, p.fin));
+				if (n.der == nulo) continue;
+
+				// Las que venian de la izquierda siguen si no se puede podar el hijo derecho
+				// pendiente, y todas las demas van ahora por el
+				for (size_t k = p.ini; k < p.medio; ++k) {
+					const activa &a = lote[k];
+					if (evals[a.q] != ~0u && pendiente(n.der, true, a.distpadre, a.dpq).hay_que_visitar(c[a.q].r)) {
+						lote.push_back(activa(a.q, a.distpadre));
+					}
+				}
+				for (size_t k = p.medio; k < p.fin; ++k) {
+					if (evals[lote[k].q] != ~0u) lote.push_back(activa(lote[k].q, lote[k].dpq));
+				}
+				if (lote.size() > p.fin) pila.apilar(paso(n.der, visitar, p.fin, p.fin, lote.size()));
+			}
+			else {
+				if (n.izq == nulo) continue;
 
-			if (dpq <= r) {
-				i = arb->i;
-				r = dpq;
-				nn = arb->elem;
+				// Las que fueron antes por la derecha siguen si no se puede podar el izquierdo
+				for (size_t k = p.medio; k < p.fin; ++k) {
+					const activa &a = lote[k];
+					if (evals[a.q] != ~0u && pendiente(n.izq, false, a.distpadre, a.dpq).hay_que_visitar(c[a.q].r)) {
+						lote.push_back(activa(a.q, a.distpadre));
+					}
+				}
+				if (lote.size() > p.fin) pila.apilar(paso(n.izq, visitar, p.fin, p.fin, lote.size()));
 			}
+		}
+	}
+
+	// Vuelve a colocar todos los nodos menos la raiz ficticia, eligiendo como raiz de cada
+	// subarbol el candidato que mas igualados deja sus dos hijos. Los nodos no se mueven del
+	// vector, solo cambian los enlaces, asi que cada uno sigue en la posicion de su orden de
+	// entrada. Un elemento va a la izquierda de un nodo si no esta mas lejos de el que del
+	// padre con el que se le compara, igual que al insertar, asi que el arbol se sigue
+	// recorriendo e insertando igual.
+	// Coste candidatos*N*log(N)*C si los subarboles quedan equilibrados
+	void construir()
+	{
+		size_t n = size() - 1;
+
+		// Cada nodo por colocar con su distancia al padre con el que se compara y su distancia
+		// al candidato a raiz de su tramo
+		std::vector<U32> ids(n);
+		std::vector<double> dpadre(n), dcand(n), dmejor(n);
+		for (size_t k = 0; k < n; ++k) {
+			ids[k] = k + 1;
+			dpadre[k] = dist(esf, nodos[ficticialRoot].elem, nodos[k + 1].elem);
+			nodos[k + 1].izq = nodos[k + 1].der = nulo;
+		}
+
+		Pila<tramo, 64> pila;
+		pila.apilar(tramo(0, n, ficticialRoot, false, 1));
+		prof = 0;
 
-			if (dpq <= distpadre) {
-				mas_cercano_rec(x, arb->izq, i, r, nn, dpq);
-				if (dpq + r > distpadre - r)
-					mas_cercano_rec(x, arb->der, i, r, nn, distpadre);
-			} else {
-				mas_cercano_rec(x, arb->der, i, r, nn, dpq);
-				if (dpq - r > distpadre + r)
-					mas_cercano_rec(x, arb->izq, i, r, nn, distpadre);
+		while (!pila.vacia()) {
+			tramo t = pila.desapilar();
+			size_t m = t.fin - t.ini;
+
+			// De los candidatos, repartidos por el tramo, se queda el que deja la diferencia
+			// mas pequena entre los que irian a cada lado
+			size_t mejor = t.ini;
+			if (m > 2) {
+				size_t diferencia = m;
+				size_t ncand = m < candidatos ? m : candidatos;
+				for (size_t c = 0; c < ncand; ++c) {
+					size_t pos = t.ini + c * m / ncand;
+					size_t izq = 0;
+					for (size_t k = t.ini; k < t.fin; ++k) {
+						if (k == pos) continue;
+						dcand[k] = dist(esf, nodos[ids[pos]].elem, nodos[ids[k]].elem);
+						if (dcand[k] <= dpadre[k]) izq++;
+					}
+					size_t der = m - 1 - izq;
+					size_t dif = izq > der ? izq - der : der - izq;
+					if (dif < diferencia) {
+						diferencia = dif;
+						mejor = pos;
+						std::copy(dcand.begin() + t.ini, dcand.begin() + t.fin, dmejor.begin() + t.ini);
+					}
+				}
+			}
+			else {
+				for (size_t k = t.ini + 1; k < t.fin; ++k) dmejor[k] = dist(esf, nodos[ids[t.ini]].elem, nodos[ids[k]].elem);
+			}
+
+			// La raiz del tramo pasa al principio y se enlaza
+			std::swap(ids[t.ini], ids[mejor]);
+			std::swap(dpadre[t.ini], dpadre[mejor]);
+			std::swap(dmejor[t.ini], dmejor[mejor]);
+			U32 arb = ids[t.ini];
+			(t.der ? nodos[t.padre].der : nodos[t.padre].izq) = arb;
+			prof = std::max(prof, t.p);
+
+			// Los demas se reparten: primero los que van a la izquierda, que pasan a compararse
+			// con arb, y despues los que van a la derecha
+			size_t medio = t.ini + 1;
+			for (size_t k = t.ini + 1; k < t.fin; ++k) {
+				if (dmejor[k] <= dpadre[k]) {
+					std::swap(ids[k], ids[medio]);
+					std::swap(dpadre[k], dpadre[medio]);
+					std::swap(dmejor[k], dmejor[medio]);
+					dpadre[medio] = dmejor[medio];
+					medio++;
+				}
 			}
+
+			if (t.fin > medio) pila.apilar(tramo(medio, t.fin, arb, true, t.p + 1));
+			if (medio > t.ini + 1) pila.apilar(tramo(t.ini + 1, medio, arb, false, t.p + 1));
 		}
 	}
 
 public:
 
-	GHT() : count(0)
+	GHT() : prof(0), factor(0.0), tam_reconstruido(0), nreconstrucciones(0)
 	{
 	}
 
-	~GHT()
+	/// Crea un GHT con los elementos de v, en ese orden de entrada, eligiendo las raices de los
+	/// subarboles para que quede equilibrado en vez de insertarlos uno a uno.
+	// Coste N*log(N)*C si los subarboles quedan equilibrados
+	GHT(const std::vector<T> &v) : prof(0), factor(0.0), tam_reconstruido(0), nreconstrucciones(0)
 	{
-		erase_nodes(ficticialRoot);
+		nodos.reserve(v.size());
+		for (size_t k = 0; k < v.size(); ++k) nodos.push_back(nodo(v[k]));
+		if (size() > 1) construir();
+		tam_reconstruido = size();
 	}
 
-	// Elimina recursivamente un nodo y todos sus hijos
-	void erase_nodes(nodo *n)
+	/// Reserva espacio para n elementos, para evitar que el vector de nodos crezca
+	/// varias veces si se conoce de antemano cuantos se van a insertar.
+	void reservar(size_t n)
 	{
-		if (n) {
-			erase_nodes(n->der);
-			erase_nodes(n->izq);
-			delete(n);
-		}
+		nodos.reserve(n);
 	}
 
 	/// Devuelve el elemento mas cercano y en i deja su posicion en orden de entrada (0 si entro el primero, etc.)
@@ -114,10 +478,53 @@ public:
 	// En caso medio, se hacen log(N) comparaciones.
 	const void mas_cercano(const T &x, int &i, double &r, T &nn) const
 	{
-		r = ficticialRoot->elem - x;
-		nn = ficticialRoot->elem;
+		mas_cercano(x, i, r, nn, esf, 0);
+	}
+
+	/// Como mas_cercano, pero contando las distancias en e y anotando en h, si no es nulo,
+	/// los huecos por los que pasa la busqueda (ver compr/indices.h).
+	const void mas_cercano(const T &x, int &i, double &r, T &nn, esfuerzo &e, rastro *h) const
+	{
+		e.empezar();
+		r = dist(e, nodos[ficticialRoot].elem, x);
+		nn = nodos[ficticialRoot].elem;
 		i = 0;
-		if (count > 1) mas_cercano_rec(x, root, i, r, nn, r);
+		if (h) h->version = nreconstrucciones;
+		if (size() > 1) mas_cercano_iter(x, i, r, nn, r, e, h, nodos[ficticialRoot].izq);
+		else if (h) anotar_huecos(ficticialRoot, *h);
+	}
+
+	/// Hace las n busquedas de c como mas_cercano, con los mismos resultados, pero recorriendo
+	/// el arbol una sola vez para todas: cada nodo se compara seguidas con todas las busquedas
+	/// que pasan por el, en vez de volver a el una vez por busqueda.
+	void mas_cercanos(consulta<T> *c, size_t n, esfuerzo &e) const
+	{
+		std::vector<activa> lote;
+		std::vector<U32> evals(n, 1);
+		lote.reserve(4 * n);
+
+		for (size_t q = 0; q < n; ++q) {
+			c[q].r = dist(e, nodos[ficticialRoot].elem, c[q].x);
+			c[q].i = 0;
+			if (c[q].h) c[q].h->version = nreconstrucciones;
+			if (size() > 1) lote.push_back(activa(q, c[q].r));
+			else if (c[q].h) anotar_huecos(ficticialRoot, *c[q].h);
+		}
+		if (!lote.empty()) mas_cercanos_iter(c, lote, evals, e);
+	}
+
+	/// Cierto si una busqueda con rastro h daria ahora el mismo resultado que cuando se hizo:
+	/// los elementos nuevos solo se enlazan en hijos que no existian, pero al reconstruir el
+	/// arbol cambia todo.
+	// Coste lineal respecto al numero de huecos del rastro
+	bool vigente(const rastro &h) const
+	{
+		if (h.version != nreconstrucciones) return false;
+		for (size_t k = 0; k < h.huecos.size(); ++k) {
+			const nodo &n = nodos[h.huecos[k] / 2];
+			if ((h.huecos[k] % 2 ? n.der : n.izq) != nulo) return false;
+		}
+		return true;
 	}
 
 	/// Devuelve el elemento mas cercano a x
@@ -127,27 +534,72 @@ public:
 	// En caso medio, se hacen log(N) comparaciones.
 	const void mas_cercano(const T &x, double &r, T &nn) const
 	{
-		mas_cercano(x, int(), r, nn);
+		int i;
+		mas_cercano(x, i, r, nn);
 	}
 
 	// Numero de elementos en el GHT
-	size_t size() const { return count; }
+	size_t size() const { return nodos.size(); }
+
+	/// Limita a n las distancias que calcula cada busqueda (0 para no limitarlas)
+	void limitar(U32 n) { esf.limitar(n); }
+
+	/// Reconstruye el arbol al insertar cuando su profundidad pasa de f*log2(size()) (0 para no
+	/// hacerlo nunca). Las busquedas pueden dar otro resultado despues de reconstruir, porque
+	/// no siempre encuentran el mas cercano.
+	void equilibrar(double f) { factor = f; }
+
+	/// Numero de distancias calculadas desde que se creo el GHT, incluidas las de reconstruirlo
+	U64 evaluaciones() const { return esf.evaluaciones(); }
+
+	/// Numero de busquedas que llegaron al limite de distancias
+	U64 agotadas() const { return esf.agotadas(); }
+
+	/// Profundidad del nodo mas profundo, contando la raiz real como 1
+	U32 profundidad() const { return prof; }
+
+	/// Profundidad media de los nodos. En un arbol equilibrado es cercana a log2(size()).
+	// Coste lineal respecto al numero de elementos
+	double profundidad_media() const
+	{
+		if (size() < 2) return 0.0;
+
+		Pila<std::pair<U32, U32>, 64> pila;
+		pila.apilar(std::make_pair(nodos[ficticialRoot].izq, 1u));
+		U64 suma = 0;
+		while (!pila.vacia()) {
+			std::pair<U32, U32> p = pila.desapilar();
+			suma += p.second;
+			if (nodos[p.first].izq != nulo) pila.apilar(std::make_pair(nodos[p.first].izq, p.second + 1));
+			if (nodos[p.first].der != nulo) pila.apilar(std::make_pair(nodos[p.first].der, p.second + 1));
+		}
+		return (double) suma / (size() - 1);
+	}
+
+	/// Numero de veces que se ha reconstruido el arbol
+	U32 reconstrucciones() const { return nreconstrucciones; }
 
 	// Inserta el elemento x en el GHT
 	// Coste log(N)*C donde N es el numero de elementos presentes en el GHT y
 	// C el coste de una comparacin de elementos
 	void insertar(const T &x)
 	{
-		if (count < 2) {
-			if (count == 0) ficticialRoot = new nodo(0, 0, x, 0);
-			else { 
-				root = new nodo(0, 0, x, 1); 
-				ficticialRoot->izq = root; 
+		if (size() < 2) {
+			// El segundo elemento es la raiz real, hijo izquierdo de la ficticia
+			if (size() == 1) {
+				nodos[ficticialRoot].izq = root;
+				prof = 1;
 			}
+			nodos.push_back(nodo(x));
 		}
-		else insertar_rec(x, root, ficticialRoot->elem - x);
+		else insertar_iter(x, dist(esf, nodos[ficticialRoot].elem, x));
 
-		count++;
+		if (factor > 0.0 && size() >= min_reconstruir && size() >= 2 * tam_reconstruido &&
+			prof > factor * std::log2((double) size() - 1)) {
+			construir();
+			tam_reconstruido = size();
+			nreconstrucciones++;
+		}
 	}
 };
 
@@ -0,0 +1,141 @@
+
+#ifndef _INDICE_EXACTO_H_
+#define _INDICE_EXACTO_H_
+
+#include "compr/compr.h"
+#include "Matriz.hpp"
+#include "types.h"
+#include <cstring>
+#include <vector>
+
+COMPRESSION_NAMESPACE_BEGIN
+
+
+// Tabla hash de bloques de una matriz indexada por su contenido exacto. Permite saber si
+// un bloque es identico a alguno de los ya guardados con un hash y una comparacion de
+// memoria, sin pasar por una busqueda en el GHT. En capturas de pantalla y documentos
+// escaneados la mayoria de bloques son repeticiones exactas de unos pocos.
+template <typename T>
+class IndiceExacto
+{
+	struct entrada {
+		U64 hash;
+
+		// Bloque de la matriz y posicion que le dio el cliente al insertarlo
+		U32 bloque;
+		U32 i;
+	};
+
+	// Posicion libre de la tabla
+	static const U32 vacia = 0xffffffff;
+
+	const Matriz<T> *m;
+
+	// Direccionamiento abierto con exploracion lineal. El tamano es potencia de 2 y
+	// se mantiene al menos la mitad de la tabla libre.
+	std::vector<entrada> tabla;
+	size_t n;
+
+	// Cierto si los bloques a y b de la matriz tienen el mismo contenido
+	bool iguales(size_t a, size_t b) const
+	{
+		size_t ancho = m->q() * sizeof(T);
+		for (int f = 0; f < m->p(); ++f) {
+			if (memcmp(&(*m)(a, f, 0), &(*m)(b, f, 0), ancho) != 0) return false;
+		}
+		return true;
+	}
+
+	void poner(const entrada &e)
+	{
+		size_t mascara = tabla.size() - 1;
+		size_t k = e.hash & mascara;
+		while (tabla[k].i != vacia) k = (k + 1) & mascara;
+		tabla[k] = e;
+	}
+
+	void crecer()
+	{
+		std::vector<entrada> vieja(2 * tabla.size());
+		vieja.swap(tabla);
+		for (size_t k = 0; k < tabla.size(); ++k) tabla[k].i = vacia;
+		for (size_t k = 0; k < vieja.size(); ++k) {
+			if (vieja[k].i != vacia) poner(vieja[k]);
+		}
+	}
+
+	static U64 mezclar(U64 h, U64 w)
+	{
+		h = (h ^ w) * 0x9e3779b97f4a7c15ULL;
+		return h ^ (h >> 29);
+	}
+
+public:
+
+	IndiceExacto(const Matriz<T> *mat) : m(mat), tabla(64), n(0)
+	{
+		for (size_t k = 0; k < tabla.size(); ++k) tabla[k].i = vacia;
+	}
+
+	/// Hash del contenido del bloque dado de la matriz.
+	// Coste lineal respecto al tamano del bloque
+	U64 hash(size_t bloque) const
+	{
+		size_t ancho = m->q() * sizeof(T);
+		U64 h = ancho;
+
+		for (int f = 0; f < m->p(); ++f) {
+			const U8 *fila = (const U8*) &(*m)(bloque, f, 0);
+
+			size_t j = 0;
+			for (; j + 8 <= ancho; j += 8) {
+				U64 w;
+				memcpy(&w, fila + j, 8);
+				h = mezclar(h, w);
+			}
+			if (j < ancho) {
+				U64 w = 0;
+				memcpy(&w, fila + j, ancho - j);
+				h = mezclar(h, w);
+			}
+		}
+
+		return h;
+	}
+
+	/// Busca un bloque guardado con el mismo contenido que el bloque dado, cuyo hash es h.
+	/// Si lo hay, devuelve cierto y deja en i la posicion con la que se inserto.
+	// Coste constante en caso medio, mas la comparacion de los bloques
+	bool buscar(size_t bloque, U64 h, U32 &i) const
+	{
+		size_t mascara = tabla.size() - 1;
+		for (size_t k = h & mascara; tabla[k].i != vacia; k = (k + 1) & mascara) {
+			if (tabla[k].hash == h && iguales(tabla[k].bloque, bloque)) {
+				i = tabla[k].i;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/// Guarda el bloque dado, cuyo hash es h, con la posicion i.
+	/// Pre: i != 0xffffffff
+	void insertar(size_t bloque, U64 h, U32 i)
+	{
+		if (2 * (n + 1) > tabla.size()) crecer();
+
+		entrada e;
+		e.hash = h;
+		e.bloque = bloque;
+		e.i = i;
+		poner(e);
+		++n;
+	}
+
+	/// Numero de bloques guardados
+	size_t size() const { return n; }
+};
+
+COMPRESSION_NAMESPACE_END
+
+#endif // _INDICE_EXACTO_H_
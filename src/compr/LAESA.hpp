@@ -0,0 +1,171 @@
+
+#ifndef _LAESA_H_
+#define _LAESA_H_
+
+#include "compr/compr.h"
+#include "compr/indices.h"
+#include "types.h"
+#include <cmath>
+#include <vector>
+
+COMPRESSION_NAMESPACE_BEGIN
+
+
+// Tabla de pivotes al estilo de LAESA. Los primeros elementos que entran hacen de pivotes, y
+// de cada elemento se guarda su distancia a todos ellos. Por la desigualdad triangular,
+// |d(x,p) - d(e,p)| no supera d(x,e) para cualquier pivote p, lo que permite descartar la
+// mayoria de elementos sin compararlos con x. No hay arbol que pueda quedar desequilibrado,
+// pero cada busqueda recorre la tabla entera. Tiene la misma interfaz que el GHT (ver
+// compr/indices.h).
+template <typename T>
+class LAESA
+{
+public:
+
+	// Maximo numero de pivotes
+	static const size_t max_pivotes = 64;
+
+private:
+
+	std::vector<T> elems;
+
+	// Distancias a los pivotes: la fila e, de k posiciones, es la del elemento e
+	std::vector<double> tabla;
+
+	// Numero de pivotes
+	size_t k;
+
+	// Distancias calculadas y limite por busqueda
+	mutable esfuerzo esf;
+
+	static double dist(esfuerzo &e, const T &a, const T &b, double limite)
+	{
+		e.contar();
+		return distancia_acotada(a, b, limite);
+	}
+
+public:
+
+	/// Crea una tabla con el numero de pivotes dado. Pre: 0 < pivotes <= max_pivotes
+	LAESA(size_t pivotes = 16) : k(pivotes)
+	{
+	}
+
+	/// Reserva espacio para n elementos
+	void reservar(size_t n)
+	{
+		elems.reserve(n);
+		tabla.reserve(n * k);
+	}
+
+	/// Inserta el elemento x en la tabla
+	// Coste k*C, donde C es el coste de una comparacion de elementos
+	void insertar(const T &x)
+	{
+		size_t e = elems.size();
+		elems.push_back(x);
+		tabla.resize(tabla.size() + k);
+
+		double *fila = &tabla[e * k];
+		if (e < k) {
+			// x es un pivote nuevo: las distancias a los anteriores, que tambien son pivotes,
+			// se apuntan en las dos filas
+			for (size_t j = 0; j < e; ++j) fila[j] = tabla[j * k + e] = dist(esf, x, elems[j], 1e300);
+			fila[e] = 0.0;
+		}
+		else {
+			for (size_t j = 0; j < k; ++j) fila[j] = dist(esf, x, elems[j], 1e300);
+		}
+	}
+
+	/// Devuelve el elemento mas cercano a x, en i su posicion en orden de entrada y en r su
+	/// distancia a x. Pre: size() > 0
+	// Coste k*C + N: x se compara con los pivotes y con los elementos que no descartan, pero
+	// la cota de todos los demas se mira en la tabla.
+	void mas_cercano(const T &x, int &i, double &r, T &nn) const
+	{
+		mas_cercano(x, i, r, nn, esf, 0);
+	}
+
+	/// Como mas_cercano, pero contando las distancias en e y anotando en h, si no es nulo,
+	/// el numero de elementos, que es de lo unico que depende el resultado.
+	void mas_cercano(const T &x, int &i, double &r, T &nn, esfuerzo &e, rastro *h) const
+	{
+		if (h) h->anotar(elems.size());
+
+		size_t npiv = elems.size() < k ? elems.size() : k;
+
+		// Distancias de x a los pivotes, que tambien son candidatos
+		double dx[max_pivotes];
+		e.empezar();
+		i = 0;
+		r = 1e300;
+		for (size_t j = 0; j < npiv; ++j) {
+			dx[j] = dist(e, x, elems[j], 1e300);
+			if (dx[j] < r) {
+				i = j;
+				r = dx[j];
+			}
+
+			// Sin todas las distancias a los pivotes no se puede usar la tabla
+			if (e.agotado()) {
+				nn = elems[i];
+				return;
+			}
+		}
+
+		for (size_t c = npiv; c < elems.size(); ++c) {
+			const double *fila = &tabla[c * k];
+
+			// Basta con un pivote cuya cota no baje de r para descartar c
+			size_t j = 0;
+			while (j < npiv && std::fabs(dx[j] - fila[j]) < r) ++j;
+			if (j < npiv) continue;
+
+			double d = dist(e, x, elems[c], r);
+			if (d < r) {
+				i = c;
+				r = d;
+			}
+			if (e.agotado()) break;
+		}
+
+		nn = elems[i];
+	}
+
+	/// Hace las n busquedas de c como mas_cercano, una tras otra
+	void mas_cercanos(consulta<T> *c, size_t n, esfuerzo &e) const
+	{
+		T nn;
+		for (size_t q = 0; q < n; ++q) mas_cercano(c[q].x, c[q].i, c[q].r, nn, e, c[q].h);
+	}
+
+	/// Cierto si una busqueda con rastro h daria ahora el mismo resultado que cuando se hizo,
+	/// que es si no se ha insertado nada desde entonces.
+	bool vigente(const rastro &h) const
+	{
+		return h.huecos[0] == elems.size();
+	}
+
+	/// Numero de elementos en la tabla
+	size_t size() const { return elems.size(); }
+
+	/// Limita a n las distancias que calcula cada busqueda (0 para no limitarlas)
+	void limitar(U32 n) { esf.limitar(n); }
+
+	/// Numero de distancias calculadas desde que se creo la tabla
+	U64 evaluaciones() const { return esf.evaluaciones(); }
+
+	/// Numero de busquedas que llegaron al limite de distancias
+	U64 agotadas() const { return esf.agotadas(); }
+
+	/// La tabla no es un arbol: no hay nada que equilibrar ni profundidad
+	void equilibrar(double) {}
+	U32 profundidad() const { return 0; }
+	double profundidad_media() const { return 0.0; }
+	U32 reconstrucciones() const { return 0; }
+};
+
+COMPRESSION_NAMESPACE_END
+
+#endif // _LAESA_H_
@@ -0,0 +1,64 @@
+
+#ifndef _PILA_H_
+#define _PILA_H_
+
+#include "compr/compr.h"
+#include <vector>
+
+COMPRESSION_NAMESPACE_BEGIN
+
+
+// Pila para los recorridos iterativos de los arboles. Los N primeros elementos se
+// guardan en la propia pila, sin reservar memoria, y solo si se apilan mas se pasa
+// a usar memoria dinamica. En arboles razonablemente equilibrados no se llega a usar.
+template <typename T, size_t N>
+class Pila
+{
+	T local[N];
+
+	// Memoria dinamica, cuando no caben en local
+	std::vector<T> dinamica;
+
+	// Zona en uso (local o dinamica): base, cima y limite
+	T *base, *cima, *limite;
+
+	Pila(const Pila&);
+	Pila& operator=(const Pila&);
+
+	// Duplica la capacidad, pasando los elementos a memoria dinamica
+	void crecer()
+	{
+		size_t n = cima - base;
+		std::vector<T> nueva(2 * (limite - base));
+		for (size_t k = 0; k < n; ++k) nueva[k] = base[k];
+		dinamica.swap(nueva);
+
+		base = &dinamica[0];
+		cima = base + n;
+		limite = base + dinamica.size();
+	}
+
+public:
+
+	Pila() : base(local), cima(local), limite(local + N) {}
+
+	bool vacia() const { return cima == base; }
+
+	size_t size() const { return cima - base; }
+
+	void apilar(const T &x)
+	{
+		if (cima == limite) crecer();
+		*cima++ = x;
+	}
+
+	/// Pre: !vacia()
+	T& desapilar()
+	{
+		return *--cima;
+	}
+};
+
+COMPRESSION_NAMESPACE_END
+
+#endif // _PILA_H_
@@ -0,0 +1,349 @@
+
+#ifndef _VPT_H_
+#define _VPT_H_
+
+#include "compr/compr.h"
+#include "compr/indices.h"
+#include "compr/Pila.hpp"
+#include "types.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+COMPRESSION_NAMESPACE_BEGIN
+
+
+// Arbol de puntos de vista (vantage-point tree) con insercion incremental. Cada nodo tiene
+// un radio mu: los elementos de su subarbol "dentro" estan a distancia no mayor que mu de el,
+// y los de "fuera" a distancia mayor. Al insertar, el radio de una hoja se fija con la
+// distancia del primer elemento que cuelga de ella, asi que con los bloques en el orden de la
+// imagen el arbol degenera en una lista. Por eso se reconstruye a menudo: cada radio pasa a
+// ser la mediana de las distancias a los elementos de su subarbol, que quedan repartidos a
+// medias entre los dos lados. Tiene la misma interfaz que el GHT (ver compr/indices.h).
+template <typename T>
+class VPT
+{
+	// Como en el GHT, los nodos se guardan en orden de entrada y se enlazan por su posicion
+	struct nodo {
+		T elem;
+
+		// Negativo mientras el nodo no tiene hijos
+		double mu;
+
+		U32 dentro, fuera;
+
+		nodo() {}
+		nodo(const T &elemp) : elem(elemp), mu(-1.0), dentro(nulo), fuera(nulo) {}
+	};
+
+	// La raiz es el primer elemento, asi que ningun nodo apunta a la posicion 0
+	static const U32 nulo = 0;
+	static const U32 root = 0;
+
+	std::vector<nodo> nodos;
+
+	// Distancias calculadas y limite por busqueda
+	mutable esfuerzo esf;
+
+	// Profundidad del nodo mas profundo, contando la raiz como 1
+	U32 prof;
+
+	// Se reconstruye cuando prof pasa de factor*log2(size()) y el arbol ha doblado su tamano
+	// desde la ultima vez, para que el coste de reconstruir no domine. A diferencia del GHT, se
+	// reconstruye aunque no se pida: sin reconstruir, los radios dependen solo del orden de
+	// entrada. Como la busqueda es exacta, el bloque encontrado solo cambia entre los que
+	// estan a la misma distancia.
+	double factor;
+	size_t tam_reconstruido;
+	U32 nreconstrucciones;
+
+	// Factor con el que se reconstruye si no se indica otro
+	static constexpr double factor_defecto = 3.0;
+
+	// Tamano minimo para reconstruir: en un arbol pequeno no compensa
+	static const size_t min_reconstruir = 64;
+
+	// Tramo [ini, fin) de los elementos por colocar en la reconstruccion, que cuelgan del
+	// nodo vp, a profundidad p
+	struct tramo {
+		size_t ini, fin;
+		U32 vp;
+		U32 p;
+
+		tramo() {}
+		tramo(size_t i, size_t f, U32 v, U32 pp) : ini(i), fin(f), vp(v), p(pp) {}
+	};
+
+	// Subarbol pendiente de visitar y cota inferior de la distancia de x a sus elementos
+	struct pendiente {
+		U32 arb;
+		double cota;
+
+		pendiente() {}
+		pendiente(U32 a, double c) : arb(a), cota(c) {}
+	};
+
+	static double dist(esfuerzo &e, const T &a, const T &b)
+	{
+		e.contar();
+		return a - b;
+	}
+
+	static double dist(esfuerzo &e, const T &a, const T &b, double limite)
+	{
+		e.contar();
+		return distancia_acotada(a, b, limite);
+	}
+
+	// Los huecos del rastro son los hijos que no existen: 2*nodo para el de dentro y
+	// 2*nodo + 1 para el de fuera. Un nodo sin hijos recibe el primero dentro.
+	void anotar_huecos(U32 arb, rastro &h) const
+	{
+		if (nodos[arb].dentro == nulo) h.anotar(2 * arb);
+		if (nodos[arb].fuera == nulo && nodos[arb].mu >= 0.0) h.anotar(2 * arb + 1);
+	}
+
+	// Enlaza x como hijo de arb en el lado indicado
+	void enlazar(U32 arb, bool dentro, const T &x)
+	{
+		// Se enlaza antes de anadir el nodo, que puede mover el vector
+		(dentro ? nodos[arb].dentro : nodos[arb].fuera) = nodos.size();
+		nodos.push_back(nodo(x));
+	}
+
+	// Vuelve a colocar todos los nodos menos la raiz. Los elementos de cada tramo se ordenan
+	// por su distancia al nodo del que cuelgan, el radio de este pasa a ser la mediana, y los
+	// que no estan mas lejos van dentro y el resto fuera. De cada lado, el mas lejano al nodo
+	// pasa a ser su hijo: un punto de vista en el borde del conjunto separa mejor que uno del
+	// centro. Los nodos no se mueven del vector, solo cambian los enlaces, asi que cada uno
+	// sigue en la posicion de su orden de entrada.
+	// Coste N*log(N)*C, y N*log(N)^2 para ordenar
+	void construir()
+	{
+		size_t n = size() - 1;
+
+		// Cada nodo por colocar con su distancia al nodo del que cuelga su tramo
+		std::vector< std::pair<double, U32> > v(n);
+		for (size_t k = 0; k < size(); ++k) {
+			nodos[k].mu = -1.0;
+			nodos[k].dentro = nodos[k].fuera = nulo;
+			if (k > 0) v[k - 1].second = k;
+		}
+
+		Pila<tramo, 64> pila;
+		pila.apilar(tramo(0, n, root, 1));
+		prof = 1;
+
+		while (!pila.vacia()) {
+			tramo t = pila.desapilar();
+			if (t.fin == t.ini) continue;
+
+			nodo &vp = nodos[t.vp];
+			for (size_t k = t.ini; k < t.fin; ++k) v[k].first = dist(esf, vp.elem, nodos[v[k].second].elem);
+			std::sort(v.begin() + t.ini, v.begin() + t.fin);
+
+			vp.mu = v[t.ini + (t.fin - t.ini - 1) / 2].first;
+			size_t medio = t.ini;
+			while (medio < t.fin && v[medio].first <= vp.mu) medio++;
+
+			// Dentro hay al menos la mediana. El hijo de cada lado es el ultimo, el mas lejano.
+			vp.dentro = v[medio - 1].second;
+			pila.apilar(tramo(t.ini, medio - 1, vp.dentro, t.p + 1));
+			if (t.fin > medio) {
+				vp.fuera = v[t.fin - 1].second;
+				pila.apilar(tramo(medio, t.fin - 1, vp.fuera, t.p + 1));
+			}
+			prof = std::max(prof, t.p + 1);
+		}
+	}
+
+public:
+
+	VPT() : prof(0), factor(factor_defecto), tam_reconstruido(0), nreconstrucciones(0)
+	{
+	}
+
+	/// Reserva espacio para n elementos
+	void reservar(size_t n)
+	{
+		nodos.reserve(n);
+	}
+
+	/// Inserta el elemento x en el arbol
+	// Coste log(N)*C en caso medio, donde C es el coste de una comparacion de elementos
+	void insertar(const T &x)
+	{
+		if (nodos.empty()) {
+			nodos.push_back(nodo(x));
+			prof = 1;
+			return;
+		}
+
+		U32 arb = root;
+		for (U32 p = 2;; ++p) {
+			nodo &n = nodos[arb];
+
+			// El primer hijo fija el radio, y va dentro
+			if (n.mu < 0.0) {
+				n.mu = dist(esf, n.elem, x);
+				enlazar(arb, true, x);
+				prof = std::max(prof, p);
+				break;
+			}
+
+			// Solo importa si la distancia supera mu, asi que basta con la acotada
+			bool dentro = dist(esf, n.elem, x, n.mu) <= n.mu;
+
+			U32 hijo = dentro ? n.dentro : n.fuera;
+			if (hijo == nulo) {
+				enlazar(arb, dentro, x);
+				prof = std::max(prof, p);
+				break;
+			}
+			arb = hijo;
+		}
+
+		if (size() >= min_reconstruir && size() >= 2 * tam_reconstruido &&
+			prof > factor * std::log2((double) size())) {
+			construir();
+			tam_reconstruido = size();
+			nreconstrucciones++;
+		}
+	}
+
+	/// Devuelve el elemento mas cercano a x, en i su posicion en orden de entrada y en r su
+	/// distancia a x. Pre: size() > 0
+	// Recorre el arbol en profundidad empezando por el lado de x en cada nodo. Coste lineal
+	// en caso peor respecto al numero de elementos, log(N) comparaciones en caso medio.
+	void mas_cercano(const T &x, int &i, double &r, T &nn) const
+	{
+		mas_cercano(x, i, r, nn, esf, 0);
+	}
+
+	/// Como mas_cercano, pero contando las distancias en e y anotando en h, si no es nulo,
+	/// los huecos por los que pasa la busqueda (ver compr/indices.h).
+	void mas_cercano(const T &x, int &i, double &r, T &nn, esfuerzo &e, rastro *h) const
+	{
+		Pila<pendiente, 64> pila;
+
+		e.empezar();
+		i = root;
+		nn = nodos[root].elem;
+		r = 1e300;
+		if (h) h->version = nreconstrucciones;
+
+		// La raiz esta en la posicion 0, la misma que marca los hijos que no existen, asi que
+		// se comprueba si hay hijo despues de visitar cada nodo
+		U32 arb = root;
+		for (;;) {
+			do {
+				const nodo &n = nodos[arb];
+
+				// Si la distancia supera mu + r, el subarbol de dentro se poda y el de fuera
+				// se visita sin cota, asi que su valor exacto no hace falta
+				double limite = n.mu < 0.0 ? r : n.mu + r;
+				double d = dist(e, x, n.elem, limite);
+
+				if (d < r) {
+					i = arb;
+					r = d;
+					nn = n.elem;
+				}
+				if (e.agotado()) return;
+				if (h) anotar_huecos(arb, *h);
+
+				if (n.mu < 0.0) break;
+
+				if (d <= n.mu) {
+					if (n.fuera != nulo) pila.apilar(pendiente(n.fuera, n.mu - d));
+					arb = n.dentro;
+				} else {
+					if (n.dentro != nulo && d <= limite) pila.apilar(pendiente(n.dentro, d - n.mu));
+					arb = n.fuera;
+				}
+			} while (arb != nulo);
+
+			// Se sigue por el ultimo subarbol pendiente que pueda tener algo a menos de r
+			for (;;) {
+				if (pila.vacia()) return;
+
+				const pendiente &p = pila.desapilar();
+				if (p.cota < r) {
+					arb = p.arb;
+					break;
+				}
+			}
+		}
+	}
+
+	/// Hace las n busquedas de c como mas_cercano, una tras otra
+	void mas_cercanos(consulta<T> *c, size_t n, esfuerzo &e) const
+	{
+		T nn;
+		for (size_t q = 0; q < n; ++q) mas_cercano(c[q].x, c[q].i, c[q].r, nn, e, c[q].h);
+	}
+
+	/// Cierto si una busqueda con rastro h daria ahora el mismo resultado que cuando se hizo:
+	/// los elementos nuevos solo se enlazan en hijos que no existian, pero al reconstruir el
+	/// arbol cambia todo.
+	bool vigente(const rastro &h) const
+	{
+		if (h.version != nreconstrucciones) return false;
+		for (size_t k = 0; k < h.huecos.size(); ++k) {
+			const nodo &n = nodos[h.huecos[k] / 2];
+			if ((h.huecos[k] % 2 ? n.fuera : n.dentro) != nulo) return false;
+		}
+		return true;
+	}
+
+	/// Numero de elementos en el arbol
+	size_t size() const { return nodos.size(); }
+
+	/// Limita a n las distancias que calcula cada busqueda (0 para no limitarlas)
+	void limitar(U32 n) { esf.limitar(n); }
+
+	/// Numero de distancias calculadas desde que se creo el arbol, incluidas las de reconstruirlo
+	U64 evaluaciones() const { return esf.evaluaciones(); }
+
+	/// Numero de busquedas que llegaron al limite de distancias
+	U64 agotadas() const { return esf.agotadas(); }
+
+	/// Reconstruye el arbol al insertar cuando su profundidad pasa de f*log2(size()), o de
+	/// factor_defecto*log2(size()) si f es 0: este arbol se reconstruye siempre.
+	void equilibrar(double f)
+	{
+		if (f > 0.0) factor = f;
+		else factor = factor_defecto;
+	}
+
+	/// Profundidad del nodo mas profundo, contando la raiz como 1
+	U32 profundidad() const { return prof; }
+
+	/// Profundidad media de los nodos
+	// Coste lineal respecto al numero de elementos
+	double profundidad_media() const
+	{
+		if (nodos.empty()) return 0.0;
+
+		// La raiz esta en la posicion nulo, asi que se apila aparte de sus hijos
+		Pila<std::pair<U32, U32>, 64> pila;
+		U64 suma = 1;
+		if (nodos[root].dentro != nulo) pila.apilar(std::make_pair(nodos[root].dentro, 2u));
+		if (nodos[root].fuera != nulo) pila.apilar(std::make_pair(nodos[root].fuera, 2u));
+		while (!pila.vacia()) {
+			std::pair<U32, U32> p = pila.desapilar();
+			suma += p.second;
+			if (nodos[p.first].dentro != nulo) pila.apilar(std::make_pair(nodos[p.first].dentro, p.second + 1));
+			if (nodos[p.first].fuera != nulo) pila.apilar(std::make_pair(nodos[p.first].fuera, p.second + 1));
+		}
+		return (double) suma / nodos.size();
+	}
+
+	/// Numero de veces que se ha reconstruido el arbol
+	U32 reconstrucciones() const { return nreconstrucciones; }
+};
+
+COMPRESSION_NAMESPACE_END
+
+#endif // _VPT_H_
@@ -0,0 +1,115 @@
+#include "compr/contexto.h"
+
+COMPRESSION_NAMESPACE_BEGIN
+
+namespace {
+
+// El blob tiene una secuencia de modos por contexto y despues la de indices explicitos (ver
+// compr/entropia.h).
+
+// Como se obtiene el indice de un bloque a partir de los ya vistos
+enum modo { modo_izquierda, modo_arriba, modo_nuevo, modo_explicito, num_modos };
+
+// Un contexto por cada combinacion de las igualdades entre vecinos de vecinos::contexto
+const int num_contextos = 4;
+
+// Indice de los vecinos que caen fuera de la rejilla
+const U32 ninguno = ~0u;
+
+// Indices de los bloques vecinos de uno, ya vistos al recorrer la rejilla por filas
+struct vecinos {
+	U32 izquierda, arriba, arriba_derecha;
+
+	vecinos(const U32 *b, U32 i, U32 columnas)
+	{
+		U32 x = i % columnas;
+		bool fila0 = i < columnas;
+		izquierda = x > 0 ? b[i - 1] : ninguno;
+		arriba = !fila0 ? b[i - columnas] : ninguno;
+		arriba_derecha = !fila0 && x + 1 < columnas ? b[i - columnas + 1] : ninguno;
+	}
+
+	// Si los vecinos son iguales entre si, el bloque suele estar dentro de una zona uniforme y
+	// repetir el de la izquierda; si no, en un borde. Con mas contextos se separan mejor los
+	// casos, pero cada secuencia lleva su propia cabecera y en imagenes pequenas no compensa.
+	int contexto() const
+	{
+		return (izquierda == arriba) * 2 + (arriba == arriba_derecha);
+	}
+};
+
+// Siguiente valor de una secuencia decodificada, comprobando que quede alguno
+inline U32 siguiente(const std::vector<U32> &v, size_t &pos)
+{
+	if (pos == v.size()) throw "muunzip: corrupt block indices";
+	return v[pos++];
+}
+
+} // namespace
+
+void codificar_indices(const U32 *bloques, U32 filas, U32 columnas, tipo_codigo codigo,
+					   secuencias_codificadas &s)
+{
+	using namespace std;
+
+	size_t n = (size_t) filas * columnas;
+	vector<U32> secuencias[num_contextos + 1];
+	vector<U32> *modos = secuencias, &explicitos = secuencias[num_contextos];
+
+	// Los bloques guardados se numeran segun aparecen, asi que el primero que no ha salido
+	// todavia suele ser uno mas que el mayor visto
+	U32 nuevo = 0;
+	for (size_t i = 0; i < n; ++i) {
+		vecinos v(bloques, i, columnas);
+		U32 b = bloques[i];
+
+		modo m;
+		if (b == v.izquierda) m = modo_izquierda;
+		else if (b == v.arriba) m = modo_arriba;
+		else if (b == nuevo) m = modo_nuevo;
+		else {
+			m = modo_explicito;
+			explicitos.push_back(b);
+		}
+		modos[v.contexto()].push_back(m);
+		if (b >= nuevo) nuevo = b + 1;
+	}
+
+	s.codificar(secuencias, num_contextos + 1, codigo);
+}
+
+void decodificar_indices(const U8 *blob, size_t tam, U32 filas, U32 columnas, tipo_codigo codigo,
+						 std::vector<U32> &bloques)
+{
+	using namespace std;
+
+	vector<U32> secuencias[num_contextos + 1];
+	vector<U32> *modos = secuencias, &explicitos = secuencias[num_contextos];
+
+	// Cada secuencia tiene como mucho un valor por bloque
+	size_t n = (size_t) filas * columnas;
+	decodificar_secuencias(blob, blob + tam, secuencias, num_contextos + 1, codigo, n);
+
+	size_t pos[num_contextos] = { 0 }, pos_explicitos = 0;
+	bloques.resize(n);
+
+	U32 nuevo = 0;
+	for (size_t i = 0; i < n; ++i) {
+		vecinos v(&bloques[0], i, columnas);
+		int c = v.contexto();
+
+		U32 b;
+		switch (siguiente(modos[c], pos[c])) {
+			case modo_izquierda:	b = v.izquierda; break;
+			case modo_arriba:		b = v.arriba; break;
+			case modo_nuevo:		b = nuevo; break;
+			case modo_explicito:	b = siguiente(explicitos, pos_explicitos); break;
+			default:				throw "muunzip: corrupt block indices";
+		}
+		if (b == ninguno) throw "muunzip: corrupt block indices";
+		bloques[i] = b;
+		if (b >= nuevo) nuevo = b + 1;
+	}
+}
+
+COMPRESSION_NAMESPACE_END
@@ -0,0 +1,32 @@
+#ifndef _CONTEXTO_H_
+#define _CONTEXTO_H_
+
+#include "compr/compr.h"
+#include "compr/entropia.h"
+#include "compr/zipfuncs.h"
+#include "types.h"
+#include <vector>
+
+COMPRESSION_NAMESPACE_BEGIN
+
+// Modelo de contexto de los indices de bloque. Los bloques vecinos suelen tener el mismo
+// indice (un fondo, una zona lisa), asi que en vez de codificar cada indice por separado se
+// codifica como se obtiene de los ya vistos: igual al de la izquierda, igual al de arriba,
+// el siguiente bloque guardado que todavia no ha salido, o un indice explicito. Los modos se
+// reparten en varias secuencias segun como son entre si los vecinos, cada una con su
+// estadistica, y los indices explicitos van en otra. Todas se guardan con el codigo dado.
+
+/// Codifica en s los indices de una rejilla de bloques de filas x columnas, por filas.
+/// O(n)
+void codificar_indices(const U32 *bloques, U32 filas, U32 columnas, tipo_codigo codigo,
+					   secuencias_codificadas &s);
+
+/// Decodifica el blob escrito por codificar_indices y deja los indices en bloques.
+/// Lanza una excepcion si el blob no es valido.
+/// O(n)
+void decodificar_indices(const U8 *blob, size_t tam, U32 filas, U32 columnas, tipo_codigo codigo,
+						 std::vector<U32> &bloques);
+
+COMPRESSION_NAMESPACE_END
+
+#endif // _CONTEXTO_H_
@@ -0,0 +1,76 @@
+#include "compr/entropia.h"
+#include "huffman/huffman.h"
+#include "rans/rans.h"
+#include <cstring>
+
+COMPRESSION_NAMESPACE_BEGIN
+
+namespace {
+
+// Codifica v con el codigo dado. Una secuencia vacia no ocupa nada.
+std::pair<void*,size_t> codificar_secuencia(std::vector<U32> &v, tipo_codigo codigo)
+{
+	if (v.empty()) return std::pair<void*,size_t>((void*) 0, 0);
+	U32 *ini = &v[0], *fin = ini + v.size();
+	return codigo == codigo_rans ? rans::encode(ini, fin) : huffman::encode<U32>(ini, fin);
+}
+
+// Decodifica una secuencia de codificar_secuencia, de max valores como mucho, y la anade a v.
+// rANS lo comprueba antes de decodificar, porque con un solo simbolo el numero de valores no
+// depende del tamano del blob; en Huffman cada valor ocupa al menos un bit del blob.
+void decodificar_secuencia(const U8 *blob, size_t tam, tipo_codigo codigo, size_t max, std::vector<U32> &v)
+{
+	if (tam == 0) return;
+	size_t antes = v.size();
+	if (codigo == codigo_rans) rans::decode(blob, tam, v, max);
+	else huffman::decode<U32>(blob, tam, v);
+	if (v.size() - antes > max) throw "muunzip: corrupt sequence";
+}
+
+} // namespace
+
+secuencias_codificadas::~secuencias_codificadas()
+{
+	for (size_t k = 0; k < partes.size(); ++k) delete[] (U8*) partes[k].first;
+}
+
+void secuencias_codificadas::codificar(std::vector<U32> *v, int n, tipo_codigo codigo)
+{
+	partes.reserve(partes.size() + n);
+	for (int k = 0; k < n; ++k) partes.push_back(codificar_secuencia(v[k], codigo));
+}
+
+size_t secuencias_codificadas::tam() const
+{
+	size_t t = 0;
+	for (size_t k = 0; k < partes.size(); ++k) t += 4 + partes[k].second;
+	return t;
+}
+
+U8* secuencias_codificadas::escribir(U8 *dst) const
+{
+	for (size_t k = 0; k < partes.size(); ++k) {
+		U32 s = partes[k].second;
+		memcpy(dst, &s, 4);
+		if (s) memcpy(dst + 4, partes[k].first, s);
+		dst += 4 + s;
+	}
+	return dst;
+}
+
+const U8* decodificar_secuencias(const U8 *blob, const U8 *fin, std::vector<U32> *v, int n, tipo_codigo codigo,
+								 size_t max)
+{
+	for (int k = 0; k < n; ++k) {
+		U32 s;
+		if (fin - blob < 4) throw "muunzip: truncated file";
+		memcpy(&s, blob, 4);
+		blob += 4;
+		if ((size_t) (fin - blob) < s) throw "muunzip: truncated file";
+		decodificar_secuencia(blob, s, codigo, max, v[k]);
+		blob += s;
+	}
+	return blob;
+}
+
+COMPRESSION_NAMESPACE_END
@@ -0,0 +1,54 @@
+#ifndef _ENTROPIA_H_
+#define _ENTROPIA_H_
+
+#include "compr/compr.h"
+#include "compr/zipfuncs.h"
+#include "types.h"
+#include <utility>
+#include <vector>
+
+COMPRESSION_NAMESPACE_BEGIN
+
+// Secuencias de enteros guardadas con el codigo de entropia del archivo (ver tipo_codigo). Las
+// partes del archivo que se codifican en varias secuencias, cada una con su estadistica, las
+// guardan juntas en un blob: de cada una, U32 con su tamano (0 si esta vacia) y la
+// secuencia codificada.
+
+/// Secuencias codificadas por separado, pendientes de escribir juntas en un blob. Asi el que
+/// las codifica sabe cuanto van a ocupar antes de tener donde escribirlas, y se escriben
+/// directamente en su sitio.
+class secuencias_codificadas
+{
+	std::vector< std::pair<void*,size_t> > partes;
+
+	secuencias_codificadas(const secuencias_codificadas&);
+	secuencias_codificadas& operator=(const secuencias_codificadas&);
+
+public:
+
+	secuencias_codificadas() {}
+	~secuencias_codificadas();
+
+	/// Codifica las n secuencias de v con el codigo dado.
+	/// O(suma de los tamanos)
+	void codificar(std::vector<U32> *v, int n, tipo_codigo codigo);
+
+	/// Bytes que ocupa el blob.
+	size_t tam() const;
+
+	/// Escribe el blob en dst, que debe tener sitio para tam() bytes.
+	/// Retorna la posicion siguiente al ultimo byte escrito.
+	U8* escribir(U8 *dst) const;
+};
+
+/// Decodifica las n secuencias de un blob de secuencias_codificadas que empieza en blob, sin
+/// pasar de fin, y anade cada una a su vector de v.
+/// Retorna la posicion siguiente a la ultima. Lanza una excepcion si el blob no es valido o
+/// alguna secuencia tiene mas de max valores.
+/// O(suma de los tamanos)
+const U8* decodificar_secuencias(const U8 *blob, const U8 *fin, std::vector<U32> *v, int n, tipo_codigo codigo,
+								 size_t max);
+
+COMPRESSION_NAMESPACE_END
+
+#endif // _ENTROPIA_H_
@@ -0,0 +1,139 @@
+#include "compr/guardados.h"
+
+COMPRESSION_NAMESPACE_BEGIN
+
+namespace {
+
+// El blob tiene las secuencias de diferencias de verde, rojo - verde y azul - verde (ver
+// compr/entropia.h), con las de todos los bloques seguidas.
+
+const int componentes = 3;
+
+// Componente c del pixel x, despues de restar el verde al rojo y al azul
+inline U8 componente(const rgb &x, int c)
+{
+	switch (c) {
+		case 0:		return x.g;
+		case 1:		return x.r - x.g;
+		default:	return x.b - x.g;
+	}
+}
+
+// Prediccion de JPEG-LS a partir del vecino de la izquierda a, el de arriba b y el de arriba a
+// la izquierda c: si c no esta entre a y b, probablemente hay un borde y se toma el de su lado;
+// si no, la zona es suave y se sigue el plano que forman los tres.
+inline U8 med(U8 a, U8 b, U8 c)
+{
+	U8 mayor = a > b ? a : b, menor = a > b ? b : a;
+	if (c >= mayor) return menor;
+	if (c <= menor) return mayor;
+	return a + b - c;
+}
+
+// Diferencia modulo 256 como simbolo: 0, -1, 1, -2, 2... pasan a 0, 1, 2, 3, 4...
+inline U32 simbolo(U8 d)
+{
+	I8 s = (I8) d;
+	return s >= 0 ? 2 * s : -2 * s - 1;
+}
+
+inline U8 diferencia(U32 s)
+{
+	return s & 1 ? (U8) ~(s >> 1) : (U8) (s >> 1);
+}
+
+// Anade a out las diferencias de los p x q valores de x con su prediccion. El primero se
+// predice con el primero del bloque anterior, los de la primera fila con el de su izquierda y
+// los de la primera columna con el de arriba.
+void diferencias(const U8 *x, unsigned p, unsigned q, U8 anterior, std::vector<U32> &out)
+{
+	out.push_back(simbolo(x[0] - anterior));
+	for (unsigned j = 1; j < q; ++j) out.push_back(simbolo(x[j] - x[j-1]));
+
+	for (unsigned i = 1; i < p; ++i) {
+		const U8 *f = x + i * q, *a = f - q;
+		out.push_back(simbolo(f[0] - a[0]));
+		for (unsigned j = 1; j < q; ++j) out.push_back(simbolo(f[j] - med(f[j-1], a[j], a[j-1])));
+	}
+}
+
+// Inversa de diferencias: reconstruye en x los p x q valores a partir de sus diferencias d
+void reconstruir(U8 *x, unsigned p, unsigned q, U8 anterior, const U32 *d)
+{
+	x[0] = anterior + diferencia(*d++);
+	for (unsigned j = 1; j < q; ++j) x[j] = x[j-1] + diferencia(*d++);
+
+	for (unsigned i = 1; i < p; ++i) {
+		U8 *f = x + i * q;
+		const U8 *a = f - q;
+		f[0] = a[0] + diferencia(*d++);
+		for (unsigned j = 1; j < q; ++j) f[j] = med(f[j-1], a[j], a[j-1]) + diferencia(*d++);
+	}
+}
+
+} // namespace
+
+void codificar_guardados(const Matriz<rgb> &m, const std::vector<U32> &vp, tipo_codigo codigo,
+						 secuencias_codificadas &s)
+{
+	using namespace std;
+
+	unsigned p = m.p(), q = m.q();
+	size_t paso = m.paso();
+	vector<U32> secuencias[componentes];
+	for (int c = 0; c < componentes; ++c) secuencias[c].reserve(vp.size() * p * q);
+
+	vector<U8> plano(p * q);
+	U8 anterior[componentes] = { 0 };
+	for (size_t k = 0; k < vp.size(); ++k) {
+		const rgb *bloque = &m(vp[k], 0, 0);
+		for (int c = 0; c < componentes; ++c) {
+			for (unsigned i = 0; i < p; ++i) {
+				for (unsigned j = 0; j < q; ++j) plano[i * q + j] = componente(bloque[i * paso + j], c);
+			}
+			diferencias(&plano[0], p, q, anterior[c], secuencias[c]);
+			anterior[c] = plano[0];
+		}
+	}
+
+	s.codificar(secuencias, componentes, codigo);
+}
+
+void decodificar_guardados(const U8 *blob, size_t tam, unsigned p, unsigned q, size_t max_bloques,
+						   tipo_codigo codigo, std::vector<rgb> &datos)
+{
+	using namespace std;
+
+	// Todas las componentes tienen un valor por pixel de cada bloque
+	size_t t = (size_t) p * q;
+	vector<U32> secuencias[componentes];
+	decodificar_secuencias(blob, blob + tam, secuencias, componentes, codigo, max_bloques * t);
+
+	size_t nbloques = secuencias[0].size() / t;
+	for (int c = 0; c < componentes; ++c) {
+		if (secuencias[c].size() != nbloques * t) throw "muunzip: corrupt block data";
+	}
+
+	// Se reconstruye bloque a bloque y componente a componente, y despues se deshace el cambio
+	// de colores
+	datos.resize(nbloques * t);
+	vector<U8> plano[componentes];
+	for (int c = 0; c < componentes; ++c) plano[c].resize(t);
+	U8 anterior[componentes] = { 0 };
+	for (size_t k = 0; k < nbloques; ++k) {
+		for (int c = 0; c < componentes; ++c) {
+			reconstruir(&plano[c][0], p, q, anterior[c], &secuencias[c][k * t]);
+			anterior[c] = plano[c][0];
+		}
+
+		rgb *bloque = &datos[k * t];
+		for (size_t i = 0; i < t; ++i) {
+			U8 g = plano[0][i];
+			bloque[i].r = plano[1][i] + g;
+			bloque[i].g = g;
+			bloque[i].b = plano[2][i] + g;
+		}
+	}
+}
+
+COMPRESSION_NAMESPACE_END
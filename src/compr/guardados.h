@@ -0,0 +1,35 @@
+#ifndef _GUARDADOS_H_
+#define _GUARDADOS_H_
+
+#include "compr/compr.h"
+#include "compr/entropia.h"
+#include "compr/zipfuncs.h"
+#include "Matriz.hpp"
+#include "ppm/ppm.h"
+#include "types.h"
+#include <vector>
+
+COMPRESSION_NAMESPACE_BEGIN
+
+// Codificacion sin perdidas de los pixels de los bloques guardados. Los colores se pasan a
+// verde, rojo - verde y azul - verde, que en imagenes naturales estan mucho menos relacionados
+// entre si, y cada componente de cada pixel se predice a partir de sus vecinos ya vistos del
+// mismo bloque (el de la izquierda, el de arriba y el de arriba a la izquierda, como en
+// JPEG-LS). Se guardan las diferencias con la prediccion, que suelen ser pequenas, en una
+// secuencia por componente con el codigo dado.
+
+/// Codifica en s los bloques guardados de m, que son los de las posiciones de vp.
+/// O(vp.size() * p * q)
+void codificar_guardados(const Matriz<rgb> &m, const std::vector<U32> &vp, tipo_codigo codigo,
+						 secuencias_codificadas &s);
+
+/// Decodifica el blob escrito por codificar_guardados, de bloques de p x q pixels, y deja los
+/// pixels en datos: los de cada bloque seguidos, fila a fila.
+/// Lanza una excepcion si el blob no es valido o tiene mas de max_bloques bloques.
+/// O(tam + bloques * p * q)
+void decodificar_guardados(const U8 *blob, size_t tam, unsigned p, unsigned q, size_t max_bloques,
+						   tipo_codigo codigo, std::vector<rgb> &datos);
+
+COMPRESSION_NAMESPACE_END
+
+#endif // _GUARDADOS_H_
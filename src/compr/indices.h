@@ -0,0 +1,158 @@
+
+#ifndef _INDICES_H_
+#define _INDICES_H_
+
+#include "compr/compr.h"
+#include "types.h"
+#include <cstring>
+#include <vector>
+
+COMPRESSION_NAMESPACE_BEGIN
+
+
+// Indices para buscar el elemento mas cercano a uno dado: GHT, VPT y LAESA. Todos tienen la
+// misma interfaz, y el compresor recibe el que se use como parametro de plantilla:
+//
+//	void reservar(size_t n);
+//	void insertar(const T &x);
+//	void mas_cercano(const T &x, int &i, double &r, T &nn) const;
+//	void mas_cercano(const T &x, int &i, double &r, T &nn, esfuerzo &e, rastro *h) const;
+//	void mas_cercanos(consulta<T> *c, size_t n, esfuerzo &e) const;
+//	bool vigente(const rastro &h) const;
+//	size_t size() const;
+//	void limitar(U32 n);
+//	void equilibrar(double f);
+//	U64 evaluaciones() const;
+//	U64 agotadas() const;
+//	U32 profundidad() const;
+//	double profundidad_media() const;
+//	U32 reconstrucciones() const;
+//
+// i es la posicion del mas cercano en orden de entrada y r su distancia a x. limitar pone un
+// maximo de distancias a calcular en cada busqueda; la que llega a el devuelve el mas cercano
+// que ha encontrado hasta entonces. evaluaciones es el numero de distancias calculadas desde
+// que se creo el indice y agotadas el de busquedas que llegaron al maximo. La distancia es el
+// operador- de T, y tiene que cumplir la desigualdad triangular para que las podas sean
+// correctas.
+//
+// equilibrar pide que el indice se reconstruya cuando su profundidad pase de f*log2(size())
+// (0 para no hacerlo nunca, o para usar su propio factor si se reconstruye siempre); los que
+// no se pueden reconstruir lo ignoran. profundidad es la del elemento mas profundo,
+// profundidad_media la media de todos (las dos 0 si el indice no es un arbol) y
+// reconstrucciones las veces que se ha reconstruido.
+//
+// La segunda version de mas_cercano cuenta las distancias en e en vez de en el indice y, si h
+// no es nulo, anota en el por donde ha pasado la busqueda. No modifica el indice, asi que se
+// pueden hacer varias a la vez desde distintos hilos mientras no se inserte nada. vigente dice
+// si los elementos insertados despues pueden cambiar el resultado de una busqueda asi; si no,
+// repetirla daria exactamente el mismo resultado. mas_cercanos hace las n busquedas de c como
+// la segunda version de mas_cercano, con los mismos resultados, pero puede aprovechar que son
+// varias para recorrer el indice menos veces.
+enum tipo_indice { indice_ght, indice_vpt, indice_laesa, num_indices };
+
+/// Nombre del indice, el mismo que se usa en la linea de comandos.
+inline const char* nombre(tipo_indice t)
+{
+	static const char *nombres[num_indices] = { "ght", "vpt", "laesa" };
+	return nombres[t];
+}
+
+/// Busca el indice con el nombre dado. Devuelve falso si no hay ninguno.
+inline bool por_nombre(const char *s, tipo_indice &t)
+{
+	for (int k = 0; k < num_indices; ++k) {
+		if (strcmp(s, nombre((tipo_indice) k)) == 0) {
+			t = (tipo_indice) k;
+			return true;
+		}
+	}
+	return false;
+}
+
+// Distancias calculadas por un indice y limite de las que puede calcular cada busqueda
+class esfuerzo
+{
+	U64 evals, _agotadas;
+
+	// Maximo por busqueda (0 si no hay) y cuenta a la que termina la busqueda en curso
+	U32 max;
+	U64 fin;
+
+public:
+
+	esfuerzo() : evals(0), _agotadas(0), max(0), fin(0) {}
+
+	/// Pone el maximo de distancias por busqueda; 0 para no limitarlas.
+	void limitar(U32 n) { max = n; }
+
+	/// Cuenta una distancia calculada.
+	void contar() { ++evals; }
+
+	/// Empieza una busqueda.
+	void empezar() { fin = max ? evals + max : ~(U64) 0; }
+
+	/// Sigue con una busqueda que ya ha calculado n distancias sin llegar al maximo
+	void seguir(U64 n) { fin = max ? evals + max - n : ~(U64) 0; }
+
+	/// Cierto si la busqueda en curso ha llegado al maximo. Se debe terminar la busqueda
+	/// en cuanto devuelva cierto, porque cada llamada que lo hace cuenta una busqueda agotada.
+	bool agotado()
+	{
+		if (evals < fin) return false;
+		++_agotadas;
+		return true;
+	}
+
+	/// Como agotado, para busquedas que se hacen a la vez y llevan cada una su cuenta: cierto
+	/// si la busqueda que ha calculado n distancias ha llegado al maximo.
+	bool agotado(U64 n)
+	{
+		if (max == 0 || n < max) return false;
+		++_agotadas;
+		return true;
+	}
+
+	U32 maximo() const { return max; }
+	U64 evaluaciones() const { return evals; }
+	U64 agotadas() const { return _agotadas; }
+};
+
+// Huecos de un indice (sitios en los que se enlazaria un elemento nuevo) por los que paso una
+// busqueda. Mientras no se llene ninguno, la busqueda daria el mismo resultado aunque se hayan
+// insertado elementos en otros sitios. Cada indice los numera a su manera. Los indices que se
+// reconstruyen apuntan tambien cuantas veces lo habian hecho, porque entonces los huecos cambian.
+struct rastro
+{
+	std::vector<U32> huecos;
+	U32 version;
+
+	rastro() : version(0) {}
+
+	void limpiar() { huecos.clear(); version = 0; }
+	void anotar(U32 h) { huecos.push_back(h); }
+};
+
+// Busqueda de un lote (ver mas_cercanos): el elemento a buscar, el resultado (como en
+// mas_cercano, salvo el elemento mas cercano, que es el de la posicion i) y, si no es nulo,
+// donde anotar los huecos por los que pasa.
+template <typename T>
+struct consulta
+{
+	T x;
+	int i;
+	double r;
+	rastro *h;
+};
+
+// Distancia entre a y b que solo tiene que ser exacta si no supera el limite; si lo supera
+// basta con un valor mayor que el limite y no mayor que la distancia. Los tipos de elemento
+// que sepan dejar de calcular la distancia a medias pueden sobrecargarla.
+template <typename T>
+double distancia_acotada(const T &a, const T &b, double limite)
+{
+	return a - b;
+}
+
+COMPRESSION_NAMESPACE_END
+
+#endif // _INDICES_H_
@@ -1,118 +1,464 @@
 #include "zipfuncs.h"
 #include "Matriz.hpp"
+#include "compr/Equipo.hpp"
 #include "compr/GHT.hpp"
+#include "compr/IndiceExacto.hpp"
+#include "compr/LAESA.hpp"
+#include "compr/VPT.hpp"
 #include "Bloque.h"
-#include "Pixel.h"
-#include "huffman/huffman.h"
+#include "compr/contexto.h"
+#include "compr/guardados.h"
+#include "cpu/cpu.h"
 #include "../types.h"
+#include <algorithm>
+#include <memory>
 #include <vector>
 
 COMPRESSION_NAMESPACE_BEGIN
 
-std::pair<void*,size_t> muzip(const PPM& img, double alpha, unsigned p, unsigned q)
-{	
-	using namespace std;
+namespace {
 
-	// Ponemos valores por defecto si no se indican en los parametros en p y q
-	if (p == -1) p = 8;
-	if (q == -1) q = 8;
-	
-	// Encapsulando pixels
-	Pixel *pixImg = new Pixel[img.width() * img.height()];
-	for (I32 i = 0; i < img.height(); ++i) {
-		for (I32 j = 0; j < img.width(); ++j) {
-			pixImg[i * img.width() + j].setImageAndPos(img, i, j);
-		}
+// Asignacion de los bloques de una imagen a bloques guardados: cada bloque se asigna al guardado
+// mas cercano, o se guarda si ninguno esta a distancia menor que alfa. Los bloques guardados se
+// buscan con un indice de tipo Indice.
+template <class Indice>
+class Emparejador
+{
+	Matriz<rgb> &m;
+
+	// alfa en las unidades de dist::bloqdist, la SAD de los tres canales: 3*alfa
+	double umbral;
+
+	// bloques[i] es el numero de bloque guardado que representa al bloque i, y vp tiene la
+	// posicion en m de los bloques guardados
+	U32 *bloques;
+	std::vector<U32> &vp;
+
+	// Sumas de cada bloque, con las que el indice descarta bloques lejanos sin compararlos
+	const std::vector< dist::resumen<rgb> > &resumenes;
+
+	Indice indice;
+
+	// Los bloques identicos a uno ya guardado se resuelven con la tabla hash, sin buscar en el indice.
+	// Con alfa <= 0 no se comprime ningun bloque, asi que no se usa.
+	bool usarExactos;
+	IndiceExacto<rgb> exactos;
+	size_t nexactos;
+
+public:
+
+	/// Empieza guardando el bloque primero. El indice se limita y equilibra segun b.
+	Emparejador(Matriz<rgb> &mat, const std::vector< dist::resumen<rgb> > &res, double alfa, const busqueda &b,
+				U32 primero, U32 *bloq, std::vector<U32> &v) :
+		m(mat), umbral(3 * alfa), bloques(bloq), vp(v), resumenes(res), usarExactos(alfa > 0), exactos(&mat),
+		nexactos(0)
+	{
+		indice.limitar(b.max_evaluaciones);
+		indice.equilibrar(b.reconstruir);
+
+		// Se inserta el primer elemento en el indice i en el resultado
+		bloques[primero] = 0;
+		vp.push_back(primero);
+		indice.insertar(bloque(primero));
+		if (usarExactos) exactos.insertar(primero, exactos.hash(primero), 0);
 	}
-	
-	// Encapsulamos la imagen en una matriz accesible por bloques
-	Matriz<Pixel> m(pixImg, img.height(), img.width(), p, q);
-	
-	// Vector de bloques de pixeles de tamano pq resultantes de la compresin
-	vector<Pixel*> vp;
-	
-	// Array para guardar los MN/pq indices de los bloques que componen la imagen comprimida
-	U32 *bloques = new U32[m.size()];
 
-	// Se inserta el primer elemento en el GHT i en el resultado
-	bloques[0] = 0;
-	vp.push_back(&m(0,0,0));
-	
-	GHT< Bloque<Pixel> > ght;
-	ght.insertar(Bloque<Pixel>(&m, 0));
+	Bloque<rgb> bloque(U32 i) const { return Bloque<rgb>(&m, i, resumenes[i]); }
 
-	// Para cada bloque de la matriz...
-	for (U32 i = 1; i < m.size(); ++i) {
-		
-		Bloque<Pixel> actual = Bloque<Pixel>(&m, i);
-		
-		I32 indiceDelMasCercano;
-		double distanciaAlMasCercano;
+	/// Hash del contenido del bloque i, si se usa la tabla de repeticiones
+	U64 hash(U32 i) const { return usarExactos ? exactos.hash(i) : 0; }
+
+	/// Cierto si el bloque i, con hash h, repite uno guardado.
+	bool conocido(U32 i, U64 h) const
+	{
+		U32 igual;
+		return usarExactos && exactos.buscar(i, h, igual);
+	}
 
+	/// Si el bloque i, con hash h, repite uno guardado, se lo asigna y devuelve cierto.
+	bool repetido(U32 i, U64 h)
+	{
+		U32 igual;
+		if (!usarExactos || !exactos.buscar(i, h, igual)) return false;
+		bloques[i] = igual;
+		nexactos++;
+		return true;
+	}
+
+	/// Busca el bloque guardado mas cercano al bloque i: deja en j su numero y en r su distancia.
+	void buscar(U32 i, int &j, double &r) const
+	{
 		// Cojemos el bloque mas cercano actual
-		Bloque<Pixel> b;	
-		ght.mas_cercano(actual, indiceDelMasCercano, distanciaAlMasCercano, b);
+		Bloque<rgb> b;
+		indice.mas_cercano(bloque(i), j, r, b);
+	}
+
+	/// Como buscar, pero sin modificar nada (ver compr/indices.h), para hacerla desde otro hilo.
+	void buscar(U32 i, int &j, double &r, esfuerzo &e, rastro &h) const
+	{
+		Bloque<rgb> b;
+		indice.mas_cercano(bloque(i), j, r, b, e, &h);
+	}
+
+	/// Hace a la vez las n busquedas de c, como la version anterior de buscar.
+	void buscar(consulta< Bloque<rgb> > *c, size_t n, esfuerzo &e) const
+	{
+		indice.mas_cercanos(c, n, e);
+	}
+
+	/// Cierto si una busqueda con rastro h daria ahora el mismo resultado.
+	bool vigente(const rastro &h) const { return indice.vigente(h); }
 
+	/// Asigna al bloque i, con hash h, el guardado j que esta a distancia r, o lo guarda.
+	void asignar(U32 i, U64 h, int j, double r)
+	{
 		// Si la distancia entre el mas cerca es menor que alfa, se comprime
-		if (distanciaAlMasCercano < alpha)  bloques[i] = indiceDelMasCercano;
+		if (r < umbral)  bloques[i] = j;
 		else {
 			// Si no, se aade al conjunto de compresion
-			ght.insertar(Bloque<Pixel>(&m, i));
+			indice.insertar(bloque(i));
+			if (usarExactos) exactos.insertar(i, h, vp.size());
 			bloques[i] = vp.size();
-			vp.push_back(&m(i,0,0));
+			vp.push_back(i);
 		}
 	}
-	
-	// Compactamos los bloques resultantes de la compresin para que queden contiguos en memoria
-	// y queden listos para almacenar en disco
-	vector< vector< vector<rgb> > > bloqdata(vp.size(), vector< vector<rgb> >(p, vector<rgb>(q)));
-	for (U32 i = 0; i < vp.size(); ++i) {
-		for (U32 j = 0; j < p; ++j) {
-			for (U32 k = 0; k < q; ++k) {
-				bloqdata[i][j][k].r = vp[i][j * m.M() + k].r();
-				bloqdata[i][j][k].g = vp[i][j * m.M() + k].g();
-				bloqdata[i][j][k].b = vp[i][j * m.M() + k].b();
+
+	/// Suma a est las estadisticas de la asignacion
+	void resumir(estadisticas &est) const
+	{
+		est.evaluaciones += indice.evaluaciones();
+		est.guardados += vp.size();
+		est.exactos += nexactos;
+		est.agotadas += indice.agotadas();
+		est.profundidad = indice.profundidad();
+		est.profundidad_media = indice.profundidad_media();
+		est.reconstrucciones = indice.reconstrucciones();
+	}
+};
+
+// Empareja los bloques ini..fin-1 de m de uno en uno, en orden.
+template <class Indice>
+void emparejar(Matriz<rgb> &m, const std::vector< dist::resumen<rgb> > &res, double alpha, const busqueda &b,
+			   U32 ini, U32 fin, U32 *bloques, std::vector<U32> &vp, estadisticas &est)
+{
+	Emparejador<Indice> e(m, res, alpha, b, ini, bloques, vp);
+
+	// Para cada bloque de la matriz...
+	for (U32 i = ini + 1; i < fin; ++i) {
+		U64 h = e.hash(i);
+		if (e.repetido(i, h)) continue;
+
+		int j;
+		double r;
+		e.buscar(i, j, r);
+		e.asignar(i, h, j, r);
+	}
+
+	e.resumir(est);
+}
+
+// Busqueda de un bloque hecha por adelantado, contra los bloques guardados antes de su lote
+struct especulacion {
+	U64 hash;
+
+	// Cierto si el bloque repite uno guardado; entonces no se busca
+	bool repetido;
+
+	int j;
+	double r;
+	rastro h;
+};
+
+// Trabajo de un hilo: busca por adelantado los bloques ini + k, ini + k + hilos, ... hasta fin.
+// La especulacion del bloque i queda en esp[i - ini]. Los bloques que no se repiten se buscan
+// todos a la vez, para que el indice los pueda llevar juntos por el arbol.
+template <class Indice>
+void especular(const Emparejador<Indice> *e, U32 ini, U32 fin, U32 k, U32 hilos,
+			   especulacion *esp, esfuerzo *esf, std::vector< consulta< Bloque<rgb> > > &c)
+{
+	c.clear();
+	for (U32 i = ini + k; i < fin; i += hilos) {
+		especulacion &s = esp[i - ini];
+		s.hash = e->hash(i);
+		s.repetido = e->conocido(i, s.hash);
+		s.h.limpiar();
+		if (!s.repetido) {
+			consulta< Bloque<rgb> > b = { e->bloque(i), 0, 0.0, &s.h };
+			c.push_back(b);
+		}
+	}
+	if (c.empty()) return;
+
+	e->buscar(&c[0], c.size(), *esf);
+
+	size_t q = 0;
+	for (U32 i = ini + k; i < fin; i += hilos) {
+		especulacion &s = esp[i - ini];
+		if (s.repetido) continue;
+		s.j = c[q].i;
+		s.r = c[q].r;
+		q++;
+	}
+}
+
+// Empareja los bloques ini..fin-1 de m con el mismo resultado que la version anterior, pero
+// por lotes: primero se buscan todos los bloques del lote contra los bloques
+// guardados hasta entonces, que no cambian mientras tanto, y despues se asignan en orden en este
+// hilo. La busqueda de un bloque solo se repite si los bloques que se guardan en su mismo lote
+// antes que el pueden cambiar su resultado. Con varios hilos las busquedas del lote se reparten
+// entre ellos; con uno se hacen todas en este, sin equipo, y el lote solo sirve para que el
+// indice las lleve juntas por el arbol (ver mas_cercanos en compr/indices.h). Con un hilo suele
+// ser mas lento que de uno en uno, porque cada busqueda repetida se paga entera, asi que solo
+// se usa si b lo pide (ver busqueda::lotes).
+template <class Indice>
+void emparejar(Matriz<rgb> &m, const std::vector< dist::resumen<rgb> > &res, double alpha, const busqueda &b,
+			   U32 hilos, U32 ini0, U32 fin0, U32 *bloques, std::vector<U32> &vp, estadisticas &est)
+{
+	Emparejador<Indice> e(m, res, alpha, b, ini0, bloques, vp);
+	std::unique_ptr<Equipo> equipo(hilos > 1 ? new Equipo(hilos) : 0);
+
+	// Cada hilo cuenta sus distancias por separado
+	std::vector<esfuerzo> esf(hilos);
+	for (U32 k = 0; k < hilos; ++k) esf[k].limitar(b.max_evaluaciones);
+	std::vector< std::vector< consulta< Bloque<rgb> > > > consultas(hilos);
+
+	// Cuantos mas bloques se guardan, mas busquedas hay que repetir, asi que el tamano del lote
+	// se ajusta segun las que se repitieron en el anterior: con lotes grandes se esperan menos
+	// veces los hilos, y con lotes pequenos se repiten menos busquedas. Con un solo hilo cada
+	// busqueda repetida se paga entera, asi que el lote se reduce en cuanto hay alguna, hasta
+	// un solo bloque, que nunca se repite: entonces es como buscar los bloques de uno en uno.
+	const U32 min_lote = hilos > 1 ? 4 * hilos : 1, max_lote = 256 * hilos;
+	U32 lote = min_lote;
+	std::vector<especulacion> esp(max_lote);
+	U64 repetidas = 0;
+
+	for (U32 ini = ini0 + 1, fin; ini < fin0; ini = fin) {
+		fin = std::min(ini + lote, fin0);
+
+		if (equipo) equipo->ejecutar([&](U32 k) { especular(&e, ini, fin, k, hilos, &esp[0], &esf[k], consultas[k]); });
+		else especular(&e, ini, fin, 0, 1, &esp[0], &esf[0], consultas[0]);
+
+		U32 repetidasLote = 0;
+		for (U32 i = ini; i < fin; ++i) {
+			especulacion &s = esp[i - ini];
+			if (e.repetido(i, s.hash)) continue;
+
+			if (!e.vigente(s.h)) {
+				e.buscar(i, s.j, s.r);
+				repetidasLote++;
+			}
+			e.asignar(i, s.hash, s.j, s.r);
+		}
+		repetidas += repetidasLote;
+
+		if (repetidasLote == 0) lote = std::min(2 * lote, max_lote);
+		else if (repetidasLote > (hilos > 1 ? lote / 8 : 0)) lote = std::max(lote / 2, min_lote);
+	}
+
+	e.resumir(est);
+	for (U32 k = 0; k < hilos; ++k) {
+		est.evaluaciones += esf[k].evaluaciones();
+		est.agotadas += esf[k].agotadas();
+	}
+	est.repetidas = repetidas;
+}
+
+// Empareja los bloques de m por bandas horizontales, cada una con su propio indice y en su
+// propio hilo, y despues junta los bloques guardados por todas las bandas en uno solo conjunto,
+// quitando los repetidos. El resultado no es el mismo que emparejando todos los bloques en
+// orden, porque cada banda solo busca entre sus propios bloques guardados.
+template <class Indice>
+void emparejar_bandas(Matriz<rgb> &m, const std::vector< dist::resumen<rgb> > &res, double alpha,
+					  const busqueda &b, U32 bandas, U32 *bloques, std::vector<U32> &vp, estadisticas &est)
+{
+	// Las bandas son de filas de bloques completas
+	size_t ncb = m.M() / m.q();
+	size_t nfb = m.size() / ncb;
+	if (bandas > nfb) bandas = nfb;
+
+	std::vector<U32> limites(bandas + 1);
+	for (U32 k = 0; k <= bandas; ++k) limites[k] = (k * nfb / bandas) * ncb;
+
+	// Cada banda numera sus bloques guardados desde 0
+	std::vector< std::vector<U32> > vpb(bandas);
+	std::vector<estadisticas> estb(bandas, estadisticas());
+
+	Equipo equipo(bandas);
+	equipo.ejecutar([&](U32 k) {
+		if (b.lotes) emparejar<Indice>(m, res, alpha, b, 1, limites[k], limites[k + 1], bloques, vpb[k], estb[k]);
+		else emparejar<Indice>(m, res, alpha, b, limites[k], limites[k + 1], bloques, vpb[k], estb[k]);
+	});
+
+	// Los bloques que guardan varias bandas se quedan en uno, con la misma tabla hash de
+	// repeticiones exactas que usa cada banda. Como en las bandas, con alfa <= 0 no se usa.
+	bool usarExactos = alpha > 0;
+	IndiceExacto<rgb> exactos(&m);
+	double suma_profundidades = 0.0;
+	size_t nguardados = 0;
+	std::vector<U32> mapa;
+
+	for (U32 k = 0; k < bandas; ++k) {
+		mapa.resize(vpb[k].size());
+		for (size_t c = 0; c < vpb[k].size(); ++c) {
+			U32 id = vpb[k][c];
+			if (usarExactos) {
+				U64 h = exactos.hash(id);
+				U32 igual;
+				if (exactos.buscar(id, h, igual)) {
+					mapa[c] = igual;
+					est.fusionados++;
+					continue;
+				}
+				exactos.insertar(id, h, vp.size());
 			}
+			mapa[c] = vp.size();
+			vp.push_back(id);
 		}
+
+		for (U32 i = limites[k]; i < limites[k + 1]; ++i) bloques[i] = mapa[bloques[i]];
+
+		est.evaluaciones += estb[k].evaluaciones;
+		est.exactos += estb[k].exactos;
+		est.agotadas += estb[k].agotadas;
+		est.repetidas += estb[k].repetidas;
+
+		// La forma es la del indice de la banda con el arbol mas profundo, y la profundidad
+		// media la de todos los bloques guardados por las bandas
+		est.profundidad = std::max(est.profundidad, estb[k].profundidad);
+		suma_profundidades += estb[k].profundidad_media * estb[k].guardados;
+		nguardados += estb[k].guardados;
+		est.reconstrucciones += estb[k].reconstrucciones;
 	}
+	est.guardados = vp.size();
+	est.profundidad_media = suma_profundidades / std::max<size_t>(nguardados, 1);
+}
+
+// Empareja con el indice de tipo Indice, por bandas, con varios hilos o con uno segun b
+template <class Indice>
+void emparejar(Matriz<rgb> &m, double alpha, const busqueda &b, U32 *bloques, std::vector<U32> &vp,
+			   estadisticas &est)
+{
+	// Sumas de cada bloque, con las que el indice descarta bloques lejanos sin compararlos
+	std::vector< dist::resumen<rgb> > resumenes;
+	dist::resumenes(m, resumenes);
 
-	// En la variable "bloques" tenemos los MN/pq indices de los bloques que conforman la imagen comprimida
-	// La variable bloqdata es un vector que contiene los datos de cada bloque que hay que guardar
-	// Tambin hay que guardar en disco los valores de N, M, p y q
+	if (b.bandas > 1) emparejar_bandas<Indice>(m, resumenes, alpha, b, b.bandas, bloques, vp, est);
+	else if (b.hilos > 1 || b.lotes) emparejar<Indice>(m, resumenes, alpha, b, b.hilos, 0, m.size(), bloques, vp, est);
+	else emparejar<Indice>(m, resumenes, alpha, b, 0, m.size(), bloques, vp, est);
+}
+
+// Cabecera del archivo: "mz", la version del formato, el codigo de los indices de bloque y
+// como se guardan los pixels de los bloques guardados
+const U8 magia[2] = { 'm', 'z' };
+const U8 version = 5;
+const size_t tam_cabecera = 5;
+
+// Escribe v en ptr, sin requisitos de alineamiento. Retorna la posicion siguiente.
+inline U8* escribir_u32(U8 *ptr, U32 v)
+{
+	memcpy(ptr, &v, 4);
+	return ptr + 4;
+}
+
+// Lee en v el valor de ptr, sin requisitos de alineamiento. Retorna la posicion siguiente.
+inline const U8* leer_u32(const U8 *ptr, U32 &v)
+{
+	memcpy(&v, ptr, 4);
+	return ptr + 4;
+}
+
+// Destino que reserva un blob nuevo en cada compresion
+struct destino_nuevo : destino {
+	U8 *blob;
 
-	// Huffman y guardar en disco
-	pair<void*,size_t> huffman_blob = huffman::encode<U32>(bloques, bloques + m.size());
+	destino_nuevo() : blob(0) {}
+	U8* reservar(size_t tam) { return blob = (U8*) new I8[tam]; }
+};
+
+} // namespace
+
+size_t muzip(const PPM& img, double alpha, unsigned p, unsigned q, destino &d,
+			 const busqueda &b, estadisticas *est, tipo_codigo codigo, tipo_guardados guardados)
+{	
+	using namespace std;
+
+	// Ponemos valores por defecto si no se indican en los parametros en p y q
+	if (p == -1) p = 8;
+	if (q == -1) q = 8;
 	
-	size_t muzip_size = 4 + huffman_blob.second + 4*4 + bloqdata.size() * p * q * 3;
-	I8* muzip_blob = new I8[muzip_size];
+	// Encapsulamos la imagen en una matriz accesible por bloques. La matriz se tesela, copiando
+	// la imagen en una sola pasada para que los pixels de cada bloque queden contiguos: las
+	// distancias entre bloques recorren entonces memoria seguida.
+	Matriz<rgb> m(img.pixels(), img.height(), img.width(), p, q, en_bloques());
+
+	// Vector de bloques de pixeles de tamano pq resultantes de la compresin
+	vector<U32> vp;
 	
-	U32* uptr = (U32*) muzip_blob;
-	*uptr++ = huffman_blob.second;
+	// Array para guardar los MN/pq indices de los bloques que componen la imagen comprimida
+	U32 *bloques = new U32[m.size()];
+
+	estadisticas e = estadisticas();
+	switch (b.indice) {
+		case indice_vpt:	emparejar< VPT< Bloque<rgb> > >(m, alpha, b, bloques, vp, e); break;
+		case indice_laesa:	emparejar< LAESA< Bloque<rgb> > >(m, alpha, b, bloques, vp, e); break;
+		default:			emparejar< GHT< Bloque<rgb> > >(m, alpha, b, bloques, vp, e); break;
+	}
+	if (est) *est = e;
+
+	// En la variable "bloques" tenemos los MN/pq indices de los bloques que conforman la imagen
+	// comprimida, y en vp, la posicion en m de los bloques que hay que guardar. Tambien hay que
+	// guardar en disco los valores de N, M, p y q.
+
+	// Se codifica primero todo lo que hay que codificar, para saber cuanto va a ocupar el archivo
+	secuencias_codificadas indices;
+	codificar_indices(bloques, img.height() / p, img.width() / q, codigo, indices);
+	delete[] bloques;
+
+	// Los pixels de los bloques guardados van tal cual, o predichos y codificados
+	secuencias_codificadas datos;
+	size_t tam_datos = vp.size() * p * q * sizeof(rgb);
+	if (guardados == guardados_predichos) {
+		codificar_guardados(m, vp, codigo, datos);
+		tam_datos = datos.tam();
+	}
+
+	size_t muzip_size = tam_cabecera + 4 + indices.tam() + 4*4 + tam_datos;
+	U8* ptr = d.reservar(muzip_size);
 	
-	memcpy(uptr, huffman_blob.first, huffman_blob.second);
+	ptr[0] = magia[0];
+	ptr[1] = magia[1];
+	ptr[2] = version;
+	ptr[3] = codigo;
+	ptr[4] = guardados;
+	ptr += tam_cabecera;
 	
-	uptr = (U32*) (muzip_blob + 4 + huffman_blob.second);
-	*uptr++ = p;
-	*uptr++ = q;
-	*uptr++ = img.width();
-	*uptr++ = img.height();
+	ptr = escribir_u32(ptr, indices.tam());
+	ptr = indices.escribir(ptr);
 	
-	U8* cptr = (U8*) uptr;
+	ptr = escribir_u32(ptr, p);
+	ptr = escribir_u32(ptr, q);
+	ptr = escribir_u32(ptr, img.width());
+	ptr = escribir_u32(ptr, img.height());
 	
-	for (U32 i = 0; i < vp.size(); ++i) {
-		for (U32 j = 0; j < p; ++j) {
-			for (U32 k = 0; k < q; ++k) {
-				*cptr++ = bloqdata[i][j][k].r;
-				*cptr++ = bloqdata[i][j][k].g;
-				*cptr++ = bloqdata[i][j][k].b;
-			}
+	// Los bloques guardados tal cual se copian directamente de la imagen al archivo
+	if (guardados == guardados_predichos) datos.escribir(ptr);
+	else {
+		for (U32 i = 0; i < vp.size(); ++i, ptr += p * q * sizeof(rgb)) {
+			cpu::nucleo.copiar(ptr, q * sizeof(rgb), (const U8*) &m(vp[i],0,0), m.paso() * sizeof(rgb),
+							   p, q * sizeof(rgb));
 		}
 	}
 	
-	delete[] bloques;
-	delete[] pixImg;
-	
-	return make_pair(muzip_blob, muzip_size);
+	return muzip_size;
+}
+
+
+std::pair<void*,size_t> muzip(const PPM& img, double alpha, unsigned p, unsigned q,
+							  const busqueda &b, estadisticas *est, tipo_codigo codigo, tipo_guardados guardados)
+{
+	destino_nuevo d;
+	size_t tam = muzip(img, alpha, p, q, d, b, est, codigo, guardados);
+	return std::make_pair((void*) d.blob, tam);
 }
 
 
@@ -120,73 +466,66 @@ PPM muunzip(const U8* input, size_t fileSize)
 {
 	using namespace std;
 
-	U32* uptr = (U32*) input;
-	U32 s = *uptr;
-	uptr++;
+	if (fileSize < tam_cabecera + 4 || input[0] != magia[0] || input[1] != magia[1])
+		throw "muunzip: not a muzip file";
+	if (input[2] != version) throw "muunzip: unsupported format version";
+	if (input[3] >= num_codigos) throw "muunzip: unknown entropy coder";
+	if (input[4] >= num_guardados) throw "muunzip: unknown block data format";
+	tipo_codigo codigo = (tipo_codigo) input[3];
+	tipo_guardados guardados = (tipo_guardados) input[4];
+	input += tam_cabecera;
+	fileSize -= tam_cabecera;
 	
-	vector<U32> bloques;
-	huffman::decode<U32>((void*)uptr, s, bloques);
+	// Tras la cabecera de 5 bytes los enteros ya no estan alineados, asi que se leen con leer_u32
+	U32 s;
+	const U8* indices = leer_u32(input, s);
+	if (4 + (size_t) s + 4*4 > fileSize) throw "muunzip: truncated file";
 	
 	size_t N, M, p, q, nBlocks;
 	
-	uptr = (U32*) (input + 4 + s);
-	p = *uptr++;
-	q = *uptr++;
-	M = *uptr++;
-	N = *uptr++;
-
-	nBlocks = (fileSize - s - 4) / (3*p*q);
+	U32 v[4];
+	const U8* ptr = indices + s;
+	for (int k = 0; k < 4; ++k) ptr = leer_u32(ptr, v[k]);
+	p = v[0];
+	q = v[1];
+	M = v[2];
+	N = v[3];
+	if (p == 0 || q == 0) throw "muunzip: invalid block size";
 
-	// Leemos los bloques del archivo
-	vector< vector< vector<rgb> > > bloqdata(nBlocks, vector< vector<rgb> >(p, vector<rgb>(q)));
-
-	U8* cptr = (U8*) uptr;
+	vector<U32> bloques;
+	decodificar_indices(indices, s, N / p, M / q, codigo, bloques);
 
-	for (U32 i = 0; i < bloqdata.size(); ++i) {
-		for (U32 j = 0; j < p; ++j) {
-			for (U32 k = 0; k < q; ++k) {
-				bloqdata[i][j][k].r = *cptr++;
-				bloqdata[i][j][k].g = *cptr++;
-				bloqdata[i][j][k].b = *cptr++;
-			}
-		}
+	// Los pixels de los bloques guardados se leen directamente del archivo si van tal cual, y si
+	// no, se decodifican. No puede haber mas bloques guardados que bloques.
+	const rgb *datos = (const rgb*) ptr;
+	vector<rgb> bloqdata;
+	size_t tam_datos = fileSize - s - 4 - 4*4;
+	if (guardados == guardados_predichos) {
+		decodificar_guardados(ptr, tam_datos, p, q, bloques.size(), codigo, bloqdata);
+		datos = bloqdata.empty() ? 0 : &bloqdata[0];
+		nBlocks = bloqdata.size() / (p*q);
 	}
+	else nBlocks = tam_datos / (3*p*q);
 
-	// Creamos una imagen nueva para guardar lo que descomprimimos, junto con las estructuras que la manejan
+	// Cada fila de cada bloque se copia en su sitio de la imagen, asi que cada pixel se escribe
+	// una sola vez. Los que no caen en ningun bloque entero (los bordes derecho e inferior, si p
+	// o q no dividen las dimensiones) se ponen a 0.
 	PPM unzippedPPM(N, M);
-	Pixel *pixUnzipImg = new Pixel[N * M];
-	for (U32 i = 0; i < N; ++i) {
-		for (U32 j = 0; j < M; ++j) {
-			pixUnzipImg[i * M + j].setImageAndPos(unzippedPPM, i, j);
-		}
-	}
-	
-	Matriz<Pixel> imagenFinal(pixUnzipImg, N, M, p, q);
-
-	// Tabla para guardar los datos descomprimidos sin estructurar
-	rgb *decompressedData = new rgb[N*M];
-	Matriz<rgb> munzip(decompressedData, N, M, p, q);
+	rgb *pixels = unzippedPPM.pixels();
 
-	// Descomprimimos
-	for (U32 i = 0; i < imagenFinal.size(); ++i) {
-		for (U32 j = 0; j < p; ++j) {
-			for (U32 k = 0; k < q; ++k) {
-				munzip(i,j,k) = bloqdata[ bloques[i] ][j][k];
-			}
-		}
+	size_t ncb = M / q, nfb = N / p;
+	size_t margen = M - ncb * q;
+	if (margen) {
+		for (size_t f = 0; f < nfb * p; ++f) memset(pixels + f * M + ncb * q, 0, margen * sizeof(rgb));
 	}
+	memset(pixels + nfb * p * M, 0, (N - nfb * p) * M * sizeof(rgb));
 
-	// Compactamos en una imagen ppm
-	for (U32 i = 0; i < N; ++i) {
-		for (U32 j = 0; j < M; ++j) {
-			rgb current = decompressedData[i * M + j];
-			imagenFinal(i, j).setValues(current.r, current.g, current.b);
-		}
+	for (size_t i = 0; i < bloques.size(); ++i) {
+		if (bloques[i] >= nBlocks) throw "muunzip: truncated file";
+		cpu::nucleo.copiar((U8*) (pixels + (i / ncb) * p * M + (i % ncb) * q), M * sizeof(rgb),
+						   (const U8*) (datos + bloques[i] * p * q), q * sizeof(rgb), p, q * sizeof(rgb));
 	}
 
-	delete[] decompressedData;
-	delete[] pixUnzipImg;
-
 	return unzippedPPM;
 }
 
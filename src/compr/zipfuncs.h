@@ -4,6 +4,7 @@
 
 #include "ppm/ppm.h"
 #include "compr/compr.h"
+#include "compr/indices.h"
 #include "types.h"
 #include <utility>
 
@@ -11,22 +12,150 @@ COMPRESSION_NAMESPACE_BEGIN
 
 const unsigned default_divisor_for_p_and_q = 64;
 
-// Estructura para encapsular los datos que van al disco
-struct rgb {
-	U8 r, g, b;
+// Como se buscan los bloques parecidos a cada bloque de la imagen
+struct busqueda {
+	// Indice en el que se guardan los bloques
+	tipo_indice indice;
+
+	// Maximo de distancias a calcular en cada busqueda, o 0 para buscar siempre el mas
+	// cercano. Con un maximo, el tiempo de cada busqueda queda acotado a cambio de que
+	// algunos bloques no encuentren el mas cercano y se guarden sin hacer falta.
+	U32 max_evaluaciones;
+
+	// Hilos con los que se buscan los bloques. El resultado es el mismo con cualquier numero.
+	U32 hilos;
+
+	// Bandas horizontales en que se divide la imagen. Cada banda se busca por separado, con su
+	// propio indice y en su propio hilo, y al final se juntan los bloques guardados por todas.
+	// El archivo es algo mayor que con una sola banda, porque no se aprovechan los parecidos
+	// entre bloques de distintas bandas. Con mas de una banda no se usa hilos.
+	U32 bandas;
+
+	// Si es mayor que 0, el indice se reconstruye equilibrado cuando su profundidad pasa de
+	// reconstruir*log2(bloques guardados), si es de los que se pueden reconstruir (ver
+	// compr/indices.h). Puede cambiar el resultado, pero no segun el numero de hilos.
+	double reconstruir;
+
+	// Con un solo hilo (o en cada banda), buscar los bloques por lotes como con varios hilos en
+	// vez de uno a uno. El resultado es el mismo; sirve para medir si recorrer el indice una
+	// vez por lote compensa las busquedas que hay que repetir.
+	bool lotes;
+
+	busqueda() : indice(indice_ght), max_evaluaciones(0), hilos(1), bandas(1), reconstruir(0.0), lotes(false) {}
 };
 
-// Comprime la imagen dada y devuelve un blob binario con el archivo muzip
+// Codigo con el que se guardan los indices de bloque en el archivo. Huffman es el mas rapido;
+// rANS se acerca mas a la entropia, y gana sobre todo cuando un bloque (un fondo liso, por
+// ejemplo) se repite mucho mas que los demas, porque Huffman gasta al menos un bit en cada uno.
+enum tipo_codigo { codigo_huffman, codigo_rans, num_codigos };
+
+/// Nombre del codigo, el mismo que se usa en la linea de comandos.
+inline const char* nombre(tipo_codigo t)
+{
+	static const char *nombres[num_codigos] = { "huffman", "rans" };
+	return nombres[t];
+}
+
+/// Busca el codigo con el nombre dado. Devuelve falso si no hay ninguno.
+inline bool por_nombre(const char *s, tipo_codigo &t)
+{
+	for (int k = 0; k < num_codigos; ++k) {
+		if (strcmp(s, nombre((tipo_codigo) k)) == 0) {
+			t = (tipo_codigo) k;
+			return true;
+		}
+	}
+	return false;
+}
+
+// Como se guardan en el archivo los pixels de los bloques guardados: tal cual, o predichos a
+// partir de sus vecinos en el bloque y con las diferencias codificadas con el codigo de los
+// indices (ver compr/guardados.h). Predichos ocupan bastante menos en fotografias, a cambio de
+// algo mas de tiempo al comprimir y al descomprimir.
+enum tipo_guardados { guardados_crudos, guardados_predichos, num_guardados };
+
+/// Nombre de la forma de guardar los bloques, la misma que se usa en la linea de comandos.
+inline const char* nombre(tipo_guardados t)
+{
+	static const char *nombres[num_guardados] = { "raw", "predict" };
+	return nombres[t];
+}
+
+/// Busca la forma de guardar los bloques con el nombre dado. Devuelve falso si no hay ninguna.
+inline bool por_nombre(const char *s, tipo_guardados &t)
+{
+	for (int k = 0; k < num_guardados; ++k) {
+		if (strcmp(s, nombre((tipo_guardados) k)) == 0) {
+			t = (tipo_guardados) k;
+			return true;
+		}
+	}
+	return false;
+}
+
+// Datos de una compresion, para comparar los indices de busqueda
+struct estadisticas {
+	// Distancias entre bloques calculadas por el indice
+	U64 evaluaciones;
+
+	// Bloques guardados en el archivo
+	size_t guardados;
+
+	// Bloques resueltos como repeticion exacta de uno guardado, sin buscar en el indice
+	size_t exactos;
+
+	// Busquedas que llegaron al maximo de distancias
+	U64 agotadas;
+
+	// Busquedas hechas por adelantado, por lotes, que hubo que repetir porque los bloques
+	// guardados despues podian cambiar su resultado. Las distancias y las busquedas agotadas
+	// incluyen las de las busquedas por adelantado.
+	U64 repetidas;
+
+	// Con varias bandas, bloques guardados por mas de una banda que se quedan en uno al juntarlas
+	size_t fusionados;
+
+	// Forma del indice al terminar: profundidad maxima y media (0 si no es un arbol) y veces
+	// que se reconstruyo. Con bandas, la maxima de todas y la media de todos los bloques.
+	U32 profundidad;
+	double profundidad_media;
+	U32 reconstrucciones;
+};
+
+// Destino del archivo comprimido. muzip calcula primero cuanto va a ocupar el archivo, pide
+// a reservar un buffer de ese tamano y lo escribe entero directamente en el, asi que el que
+// comprime puede dar su propio buffer (por ejemplo, uno que reutiliza entre compresiones).
+struct destino {
+	virtual ~destino() {}
+
+	// Devuelve un buffer de al menos tam bytes, que debe seguir valido al terminar muzip
+	virtual U8* reservar(size_t tam) = 0;
+};
+
+// Comprime la imagen dada y devuelve un blob binario con el archivo muzip, que se libera con
+// delete[] (I8*)
+// Los bloques cercanos se buscan como indique b, los indices de bloque se guardan con el
+// codigo dado y los pixels de los bloques guardados, como indique guardados. Si est no es
+// nulo, se dejan en el las estadisticas de la compresion.
 // Coste en caso peor: O(N^2)
 // Coste en caso medio = N log(N) + Delta donde Delta es un parametro que depende de p, q y alpha.
 // N es el numero de pixeles de la imagen "img".
-std::pair<void*,size_t> muzip(const PPM& img, double alpha, unsigned p, unsigned q);
+std::pair<void*,size_t> muzip(const PPM& img, double alpha, unsigned p, unsigned q,
+							  const busqueda &b = busqueda(), estadisticas *est = 0,
+							  tipo_codigo codigo = codigo_huffman, tipo_guardados guardados = guardados_crudos);
+
+// Como la anterior, pero escribe el archivo en el buffer que de d. Devuelve su tamano.
+size_t muzip(const PPM& img, double alpha, unsigned p, unsigned q, destino &d,
+			 const busqueda &b = busqueda(), estadisticas *est = 0,
+			 tipo_codigo codigo = codigo_huffman, tipo_guardados guardados = guardados_crudos);
 
 /*! Paso final de la descompresion mu-zip
  *
  *	\return Imagen PPM	resultante de la descompresion
  *	\param	input[in]	Archivo muzip a descomprimir
  *	\param	fileSize	Tamano del archivo input
+ *
+ *	Lanza una excepcion si input no es un archivo muzip valido.
  */
 // Coste lineal respecto al tamao del archivo comprimido
 PPM muunzip(const U8* input, size_t fileSize);
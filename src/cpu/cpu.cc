@@ -0,0 +1,100 @@
+#include "cpu/cpu.h"
+#include <string>
+
+#if defined(CPU_X86) && !defined(__GNUG__)
+	#include <intrin.h>
+#endif
+
+namespace {
+
+const char* nombres[cpu::num_isas] = { "scalar", "sse2", "sse4.1", "avx2", "avx512" };
+
+const cpu::nucleos* tabla(cpu::isa i)
+{
+	switch (i)
+	{
+#ifdef CPU_X86
+		case cpu::isa_sse2:		return &cpu::nucleos_sse2;
+		case cpu::isa_sse41:	return &cpu::nucleos_sse41;
+		case cpu::isa_avx2:		return &cpu::nucleos_avx2;
+		case cpu::isa_avx512:	return &cpu::nucleos_avx512;
+#endif
+		default:				return &cpu::nucleos_escalar;
+	}
+}
+
+#if defined(CPU_X86) && !defined(__GNUG__)
+
+// Cierto si el bit b de la palabra w de CPUID(hoja, subhoja) esta activo
+bool cpuid_bit(int hoja, int subhoja, int w, int b)
+{
+	int r[4];
+	__cpuidex(r, hoja, subhoja);
+	return (r[w] >> b) & 1;
+}
+
+#endif
+
+// Se decide una sola vez, al arrancar
+cpu::isa mejor = cpu::detectar();
+cpu::isa seleccionada = mejor;
+
+} // namespace
+
+cpu::nucleos cpu::nucleo = *tabla(mejor);
+
+cpu::isa cpu::detectar()
+{
+#if defined(CPU_X86) && defined(__GNUG__)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+		__builtin_cpu_supports("avx512vl")) return isa_avx512;
+	if (__builtin_cpu_supports("avx2")) return isa_avx2;
+	if (__builtin_cpu_supports("sse4.1")) return isa_sse41;
+	if (__builtin_cpu_supports("sse2")) return isa_sse2;
+#elif defined(CPU_X86)
+	// Ademas del procesador, el sistema operativo tiene que guardar los registros anchos
+	bool osxsave = cpuid_bit(1, 0, 2, 27);
+	U64 xcr0 = osxsave ? _xgetbv(0) : 0;
+	bool ymm = (xcr0 & 0x6) == 0x6;
+	bool zmm = (xcr0 & 0xe6) == 0xe6;
+
+	if (zmm && cpuid_bit(7, 0, 1, 16) && cpuid_bit(7, 0, 1, 30) && cpuid_bit(7, 0, 1, 31)) return isa_avx512;
+	if (ymm && cpuid_bit(7, 0, 1, 5)) return isa_avx2;
+	if (cpuid_bit(1, 0, 2, 19)) return isa_sse41;
+	if (cpuid_bit(1, 0, 3, 26)) return isa_sse2;
+#endif
+	return isa_escalar;
+}
+
+bool cpu::soportada(isa i)
+{
+	return i >= isa_escalar && i <= mejor;
+}
+
+const char* cpu::nombre(isa i)
+{
+	return nombres[i];
+}
+
+cpu::isa cpu::actual()
+{
+	return seleccionada;
+}
+
+bool cpu::seleccionar(isa i)
+{
+	if (!soportada(i)) return false;
+
+	nucleo = *tabla(i);
+	seleccionada = i;
+	return true;
+}
+
+bool cpu::seleccionar(const char* n)
+{
+	for (int i = 0; i < num_isas; ++i) {
+		if (std::string(n) == nombres[i]) return seleccionar((isa) i);
+	}
+	return false;
+}
@@ -0,0 +1,81 @@
+
+#ifndef _CPU_H_
+#define _CPU_H_
+
+#include "types.h"
+#include <cstring> // size_t
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+	#define CPU_X86
+#endif
+
+namespace cpu {
+
+/// Juegos de instrucciones para los que hay version de los nucleos de calculo.
+/// Estan ordenados: cada uno incluye a los anteriores.
+enum isa { isa_escalar, isa_sse2, isa_sse41, isa_avx2, isa_avx512, num_isas };
+
+/// Nucleos de calculo intensivo del compresor. Cada juego de instrucciones
+/// aporta su propia version de todos ellos y todas dan el mismo resultado.
+struct nucleos
+{
+	/*! Suma de diferencias absolutas (SAD) entre dos bloques de bytes.
+	 *
+	 *	\param a		Primer byte del primer bloque
+	 *	\param b		Primer byte del segundo bloque
+	 *	\param paso		Distancia en bytes entre el inicio de dos filas consecutivas
+	 *	\param filas	Numero de filas del bloque
+	 *	\param ancho	Numero de bytes de cada fila
+	 */
+	U32 (*sad)(const U8 *a, const U8 *b, size_t paso, int filas, int ancho);
+
+	/// Igual que sad, pero deja de sumar en cuanto la suma de las filas recorridas supera
+	/// el limite. Si la SAD no supera el limite devuelve su valor exacto, y si no, un valor
+	/// mayor que el limite y no mayor que la SAD.
+	U32 (*sad_acotada)(const U8 *a, const U8 *b, size_t paso, int filas, int ancho, U32 limite);
+
+	/// Copia un bloque de "filas" filas de "ancho" bytes. Las filas del origen estan
+	/// separadas paso_src bytes y las del destino paso_dst.
+	void (*copiar)(U8 *dst, size_t paso_dst, const U8 *src, size_t paso_src, int filas, int ancho);
+
+	/// Suma a cuentas[v] el numero de apariciones de cada valor v de datos[0..n-1].
+	/// Pre: todos los valores de datos son menores que k, el numero de entradas de cuentas.
+	void (*histograma)(const U32 *datos, size_t n, U32 *cuentas, size_t k);
+};
+
+/// Nucleos en uso. Al arrancar se eligen los del mejor juego de instrucciones
+/// que soporte el procesador.
+extern nucleos nucleo;
+
+/// Versiones de los nucleos para cada juego de instrucciones.
+extern const nucleos nucleos_escalar;
+#ifdef CPU_X86
+extern const nucleos nucleos_sse2;
+extern const nucleos nucleos_sse41;
+extern const nucleos nucleos_avx2;
+extern const nucleos nucleos_avx512;
+#endif
+
+/// Mejor juego de instrucciones soportado por el procesador (consultando CPUID).
+isa detectar();
+
+/// Cierto si el procesador soporta el juego de instrucciones dado.
+bool soportada(isa i);
+
+/// Nombre del juego de instrucciones, tal y como se indica en --isa=
+const char* nombre(isa i);
+
+/// Juego de instrucciones de los nucleos en uso.
+isa actual();
+
+/// Pasa a usar los nucleos del juego de instrucciones dado.
+/// Devuelve falso si el procesador no lo soporta, en cuyo caso no cambia nada.
+bool seleccionar(isa i);
+
+/// Igual que la anterior, pero a partir del nombre del juego de instrucciones.
+/// Devuelve falso si el nombre no es valido o el procesador no lo soporta.
+bool seleccionar(const char* nombre);
+
+} // namespace cpu end
+
+#endif // _CPU_H_
@@ -0,0 +1,180 @@
+#include "cpu/cpu.h"
+
+#ifdef CPU_X86
+
+#include "cpu/nucleos_comunes.h"
+#include <immintrin.h>
+
+// Nucleos para AVX2. Se compila con las opciones de ese juego de instrucciones.
+
+namespace {
+
+/// Carga 16 bytes de la fila a en la mitad baja y 16 de la fila b en la alta.
+inline __m256i cargar2x16(const U8 *a, const U8 *b)
+{
+	return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*) a)),
+								   _mm_loadu_si128((const __m128i*) b), 1);
+}
+
+/// Carga 8 bytes de la fila a en la mitad baja y 8 de la fila b en la alta.
+inline __m128i cargar2x8(const U8 *a, const U8 *b)
+{
+	return _mm_castpd_si128(_mm_loadh_pd(_mm_castsi128_pd(_mm_loadl_epi64((const __m128i*) a)),
+										 (const double*) b));
+}
+
+/// SAD de los 32 bytes apuntados por a y b.
+inline __m256i sad32(const U8 *a, const U8 *b)
+{
+	return _mm256_sad_epu8(_mm256_loadu_si256((const __m256i*) a), _mm256_loadu_si256((const __m256i*) b));
+}
+
+/// Sumas parciales de la SAD: las de los registros de 256 y 128 bits, y la de los
+/// bytes sueltos del final de las filas.
+struct acumulador
+{
+	__m256i a256;
+	__m128i a128;
+	U32 s;
+
+	acumulador() : a256(_mm256_setzero_si256()), a128(_mm_setzero_si128()), s(0) {}
+
+	U32 total() const
+	{
+		__m128i t = _mm_add_epi64(a128, _mm256_castsi256_si128(a256));
+		t = _mm_add_epi64(t, _mm256_extracti128_si256(a256, 1));
+		return s + _mm_extract_epi32(t, 0) + _mm_extract_epi32(t, 2);
+	}
+};
+
+/// Acumula la SAD de dos filas consecutivas de n bytes. Los bloques suelen tener filas
+/// de 12, 24 o 48 bytes, asi que se juntan las dos filas para llenar los registros.
+inline void sad_2filas(const U8 *a, const U8 *b, size_t paso, int n, acumulador &acc)
+{
+	int j = 0;
+	for (; j + 32 <= n; j += 32) {
+		acc.a256 = _mm256_add_epi64(acc.a256, sad32(a + j, b + j));
+		acc.a256 = _mm256_add_epi64(acc.a256, sad32(a + paso + j, b + paso + j));
+	}
+	for (; j + 16 <= n; j += 16) {
+		__m256i x = cargar2x16(a + j, a + paso + j);
+		__m256i y = cargar2x16(b + j, b + paso + j);
+		acc.a256 = _mm256_add_epi64(acc.a256, _mm256_sad_epu8(x, y));
+	}
+	if (j + 8 <= n) {
+		__m128i x = cargar2x8(a + j, a + paso + j);
+		__m128i y = cargar2x8(b + j, b + paso + j);
+		acc.a128 = _mm_add_epi64(acc.a128, _mm_sad_epu8(x, y));
+		j += 8;
+	}
+	acc.s += nucleos_comunes::sad_fila(a + j, b + j, n - j);
+	acc.s += nucleos_comunes::sad_fila(a + paso + j, b + paso + j, n - j);
+}
+
+/// Acumula la SAD de una sola fila de n bytes.
+inline void sad_1fila(const U8 *a, const U8 *b, int n, acumulador &acc)
+{
+	int j = 0;
+	for (; j + 32 <= n; j += 32) acc.a256 = _mm256_add_epi64(acc.a256, sad32(a + j, b + j));
+	for (; j + 16 <= n; j += 16) {
+		__m128i x = _mm_loadu_si128((const __m128i*) (a + j));
+		__m128i y = _mm_loadu_si128((const __m128i*) (b + j));
+		acc.a128 = _mm_add_epi64(acc.a128, _mm_sad_epu8(x, y));
+	}
+	if (j + 8 <= n) {
+		__m128i x = _mm_loadl_epi64((const __m128i*) (a + j));
+		__m128i y = _mm_loadl_epi64((const __m128i*) (b + j));
+		acc.a128 = _mm_add_epi64(acc.a128, _mm_sad_epu8(x, y));
+		j += 8;
+	}
+	acc.s += nucleos_comunes::sad_fila(a + j, b + j, n - j);
+}
+
+template <int F, int A>
+U32 sad_t(const U8 *a, const U8 *b, size_t paso, int filas, int ancho)
+{
+	if (F) {
+		filas = F;
+		ancho = A;
+	}
+
+	acumulador acc;
+
+	int i = 0;
+	for (; i + 2 <= filas; i += 2, a += 2 * paso, b += 2 * paso) sad_2filas(a, b, paso, ancho, acc);
+
+	// Ultima fila si hay un numero impar
+	if (i < filas) sad_1fila(a, b, ancho, acc);
+
+	return acc.total();
+}
+
+template <int F, int A>
+U32 sad_acotada_t(const U8 *a, const U8 *b, size_t paso, int filas, int ancho, U32 limite)
+{
+	if (F) {
+		filas = F;
+		ancho = A;
+	}
+
+	acumulador acc;
+
+	// Se comprueba el limite cada dos filas
+	int i = 0;
+	for (; i + 2 <= filas; i += 2, a += 2 * paso, b += 2 * paso) {
+		sad_2filas(a, b, paso, ancho, acc);
+		if (acc.total() > limite) return acc.total();
+	}
+
+	if (i < filas) sad_1fila(a, b, ancho, acc);
+
+	return acc.total();
+}
+
+template <int F, int A>
+void copiar_t(U8 *dst, size_t paso_dst, const U8 *src, size_t paso_src, int filas, int ancho)
+{
+	if (F) {
+		filas = F;
+		ancho = A;
+	}
+
+	for (int i = 0; i < filas; ++i, dst += paso_dst, src += paso_src) {
+		int j = 0;
+		for (; j + 32 <= ancho; j += 32) {
+			_mm256_storeu_si256((__m256i*) (dst + j), _mm256_loadu_si256((const __m256i*) (src + j)));
+		}
+		if (j + 16 <= ancho) {
+			_mm_storeu_si128((__m128i*) (dst + j), _mm_loadu_si128((const __m128i*) (src + j)));
+			j += 16;
+		}
+		if (j + 8 <= ancho) {
+			_mm_storel_epi64((__m128i*) (dst + j), _mm_loadl_epi64((const __m128i*) (src + j)));
+			j += 8;
+		}
+		memcpy(dst + j, src + j, ancho - j);
+	}
+}
+
+// Versiones de los nucleos de bloques para los tamanos mas comunes (ver nucleos_comunes.h)
+
+U32 sad(const U8 *a, const U8 *b, size_t paso, int filas, int ancho)
+{
+	return POR_TAMANO(sad_t, filas, ancho, a, b, paso, filas, ancho);
+}
+
+U32 sad_acotada(const U8 *a, const U8 *b, size_t paso, int filas, int ancho, U32 limite)
+{
+	return POR_TAMANO(sad_acotada_t, filas, ancho, a, b, paso, filas, ancho, limite);
+}
+
+void copiar(U8 *dst, size_t paso_dst, const U8 *src, size_t paso_src, int filas, int ancho)
+{
+	POR_TAMANO(copiar_t, filas, ancho, dst, paso_dst, src, paso_src, filas, ancho);
+}
+
+} // namespace
+
+const cpu::nucleos cpu::nucleos_avx2 = { sad, sad_acotada, copiar, nucleos_comunes::histograma_bancos };
+
+#endif // CPU_X86
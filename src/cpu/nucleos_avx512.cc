@@ -0,0 +1,143 @@
+#include "cpu/cpu.h"
+
+#ifdef CPU_X86
+
+#include "cpu/nucleos_comunes.h"
+#include <immintrin.h>
+
+// Nucleos para AVX-512 (F, BW y VL). Se compila con las opciones de ese juego de instrucciones.
+// Las cargas con mascara no acceden a los bytes descartados, con lo que el final de cada
+// fila se trata sin bucles escalares y sin leer fuera del bloque.
+
+namespace {
+
+/// Mascara con los n bits mas bajos activos (0 <= n <= 64).
+inline __mmask64 mascara(int n)
+{
+	return n >= 64 ? ~(__mmask64) 0 : (((__mmask64) 1) << n) - 1;
+}
+
+/// Carga hasta 32 bytes de la fila a en la mitad baja y de la fila b en la alta.
+inline __m512i cargar2x32(__mmask32 m, const U8 *a, const U8 *b)
+{
+	return _mm512_inserti64x4(_mm512_castsi256_si512(_mm256_maskz_loadu_epi8(m, a)),
+							  _mm256_maskz_loadu_epi8(m, b), 1);
+}
+
+/// Acumula la SAD de una fila de n bytes. resto es la mascara de los n % 64 ultimos bytes.
+inline __m512i sad_fila(const U8 *a, const U8 *b, int n, __mmask64 resto, __m512i acc)
+{
+	int j = 0;
+	for (; j + 64 <= n; j += 64) {
+		__m512i x = _mm512_loadu_si512((const void*) (a + j));
+		__m512i y = _mm512_loadu_si512((const void*) (b + j));
+		acc = _mm512_add_epi64(acc, _mm512_sad_epu8(x, y));
+	}
+	if (j < n) {
+		__m512i x = _mm512_maskz_loadu_epi8(resto, a + j);
+		__m512i y = _mm512_maskz_loadu_epi8(resto, b + j);
+		acc = _mm512_add_epi64(acc, _mm512_sad_epu8(x, y));
+	}
+	return acc;
+}
+
+/// Acumula la SAD de dos filas consecutivas de hasta 32 bytes, seleccionados por m.
+inline __m512i sad_2filas(const U8 *a, const U8 *b, size_t paso, __mmask32 m, __m512i acc)
+{
+	__m512i x = cargar2x32(m, a, a + paso);
+	__m512i y = cargar2x32(m, b, b + paso);
+	return _mm512_add_epi64(acc, _mm512_sad_epu8(x, y));
+}
+
+template <int F, int A>
+U32 sad_t(const U8 *a, const U8 *b, size_t paso, int filas, int ancho)
+{
+	if (F) {
+		filas = F;
+		ancho = A;
+	}
+
+	__m512i acc = _mm512_setzero_si512();
+
+	int i = 0;
+	if (ancho <= 32) {
+		// Filas cortas (bloques de hasta 10 pixels de ancho): dos filas por registro
+		__mmask32 m = (__mmask32) mascara(ancho);
+		for (; i + 2 <= filas; i += 2, a += 2 * paso, b += 2 * paso) acc = sad_2filas(a, b, paso, m, acc);
+	}
+
+	__mmask64 resto = mascara(ancho % 64);
+	for (; i < filas; ++i, a += paso, b += paso) acc = sad_fila(a, b, ancho, resto, acc);
+
+	return (U32) _mm512_reduce_add_epi64(acc);
+}
+
+template <int F, int A>
+U32 sad_acotada_t(const U8 *a, const U8 *b, size_t paso, int filas, int ancho, U32 limite)
+{
+	if (F) {
+		filas = F;
+		ancho = A;
+	}
+
+	__m512i acc = _mm512_setzero_si512();
+
+	int i = 0;
+	if (ancho <= 32) {
+		__mmask32 m = (__mmask32) mascara(ancho);
+		for (; i + 2 <= filas; i += 2, a += 2 * paso, b += 2 * paso) {
+			acc = sad_2filas(a, b, paso, m, acc);
+			if (_mm512_reduce_add_epi64(acc) > limite) return (U32) _mm512_reduce_add_epi64(acc);
+		}
+	}
+
+	__mmask64 resto = mascara(ancho % 64);
+	for (; i < filas; ++i, a += paso, b += paso) {
+		acc = sad_fila(a, b, ancho, resto, acc);
+		if (_mm512_reduce_add_epi64(acc) > limite) break;
+	}
+
+	return (U32) _mm512_reduce_add_epi64(acc);
+}
+
+template <int F, int A>
+void copiar_t(U8 *dst, size_t paso_dst, const U8 *src, size_t paso_src, int filas, int ancho)
+{
+	if (F) {
+		filas = F;
+		ancho = A;
+	}
+
+	__mmask64 resto = mascara(ancho % 64);
+
+	for (int i = 0; i < filas; ++i, dst += paso_dst, src += paso_src) {
+		int j = 0;
+		for (; j + 64 <= ancho; j += 64) {
+			_mm512_storeu_si512((void*) (dst + j), _mm512_loadu_si512((const void*) (src + j)));
+		}
+		if (j < ancho) _mm512_mask_storeu_epi8(dst + j, resto, _mm512_maskz_loadu_epi8(resto, src + j));
+	}
+}
+
+// Versiones de los nucleos de bloques para los tamanos mas comunes (ver nucleos_comunes.h)
+
+U32 sad(const U8 *a, const U8 *b, size_t paso, int filas, int ancho)
+{
+	return POR_TAMANO(sad_t, filas, ancho, a, b, paso, filas, ancho);
+}
+
+U32 sad_acotada(const U8 *a, const U8 *b, size_t paso, int filas, int ancho, U32 limite)
+{
+	return POR_TAMANO(sad_acotada_t, filas, ancho, a, b, paso, filas, ancho, limite);
+}
+
+void copiar(U8 *dst, size_t paso_dst, const U8 *src, size_t paso_src, int filas, int ancho)
+{
+	POR_TAMANO(copiar_t, filas, ancho, dst, paso_dst, src, paso_src, filas, ancho);
+}
+
+} // namespace
+
+const cpu::nucleos cpu::nucleos_avx512 = { sad, sad_acotada, copiar, nucleos_comunes::histograma_bancos };
+
+#endif // CPU_X86
@@ -0,0 +1,44 @@
+
+#ifndef _NUCLEOS_COMUNES_H_
+#define _NUCLEOS_COMUNES_H_
+
+#include "types.h"
+#include <cstring> // size_t, memcpy
+
+// Piezas compartidas por las distintas versiones de los nucleos. Cada fichero de nucleos
+// se compila con las opciones de su juego de instrucciones, asi que lo que se defina aqui
+// tiene que tener enlace interno: si no, el enlazador podria quedarse con una copia
+// compilada para AVX2 y usarla tambien en procesadores que no lo soportan.
+namespace nucleos_comunes {
+
+/// SAD de los n bytes apuntados por a y b.
+static inline U32 sad_fila(const U8 *a, const U8 *b, int n)
+{
+	U32 s = 0;
+	for (int j = 0; j < n; ++j) {
+		int d = a[j] - b[j];
+		s += d < 0 ? -d : d;
+	}
+	return s;
+}
+
+/// Los nucleos de bloques (sad, sad_acotada y copiar) se escriben como plantillas f<F, A> en las
+/// que F y A, si no son 0, sustituyen a las filas y al ancho que se pasan. Los bloques de 4x4,
+/// 8x8 y 16x16 pixels rgb son los mas comunes, y con sus medidas constantes el compilador puede
+/// desenrollar los bucles. POR_TAMANO(f, filas, ancho, ...) llama con los argumentos dados a la
+/// version de f para el tamano del bloque, o a f<0, 0>, la general, si no es ninguno de esos.
+#define POR_TAMANO(f, filas, ancho, ...) \
+	((filas) == 8 && (ancho) == 24 ? f<8, 24>(__VA_ARGS__) : \
+	 (filas) == 4 && (ancho) == 12 ? f<4, 12>(__VA_ARGS__) : \
+	 (filas) == 16 && (ancho) == 48 ? f<16, 48>(__VA_ARGS__) : f<0, 0>(__VA_ARGS__))
+
+/// Histograma con cuatro tablas de cuentas que se suman al final. Evita que las
+/// apariciones consecutivas de un mismo valor esperen cada una a la escritura de la
+/// anterior. No tiene nada de vectorial, asi que se compila una sola vez (junto con
+/// los nucleos escalares) y lo comparten todas las versiones vectoriales.
+/// k es el numero de entradas de cuentas.
+void histograma_bancos(const U32 *datos, size_t n, U32 *cuentas, size_t k);
+
+} // namespace nucleos_comunes end
+
+#endif // _NUCLEOS_COMUNES_H_
@@ -0,0 +1,95 @@
+#include "cpu/cpu.h"
+#include "cpu/nucleos_comunes.h"
+
+// Version portable de los nucleos. Sirve de referencia para el resto.
+
+namespace {
+
+template <int F, int A>
+U32 sad_t(const U8 *a, const U8 *b, size_t paso, int filas, int ancho)
+{
+	if (F) {
+		filas = F;
+		ancho = A;
+	}
+
+	U32 s = 0;
+	for (int i = 0; i < filas; ++i, a += paso, b += paso) s += nucleos_comunes::sad_fila(a, b, ancho);
+	return s;
+}
+
+template <int F, int A>
+U32 sad_acotada_t(const U8 *a, const U8 *b, size_t paso, int filas, int ancho, U32 limite)
+{
+	if (F) {
+		filas = F;
+		ancho = A;
+	}
+
+	U32 s = 0;
+	for (int i = 0; i < filas && s <= limite; ++i, a += paso, b += paso) s += nucleos_comunes::sad_fila(a, b, ancho);
+	return s;
+}
+
+template <int F, int A>
+void copiar_t(U8 *dst, size_t paso_dst, const U8 *src, size_t paso_src, int filas, int ancho)
+{
+	if (F) {
+		filas = F;
+		ancho = A;
+	}
+
+	for (int i = 0; i < filas; ++i, dst += paso_dst, src += paso_src) memcpy(dst, src, ancho);
+}
+
+void histograma(const U32 *datos, size_t n, U32 *cuentas, size_t)
+{
+	for (size_t i = 0; i < n; ++i) cuentas[datos[i]]++;
+}
+
+// Versiones de los nucleos de bloques para los tamanos mas comunes (ver nucleos_comunes.h)
+
+U32 sad(const U8 *a, const U8 *b, size_t paso, int filas, int ancho)
+{
+	return POR_TAMANO(sad_t, filas, ancho, a, b, paso, filas, ancho);
+}
+
+U32 sad_acotada(const U8 *a, const U8 *b, size_t paso, int filas, int ancho, U32 limite)
+{
+	return POR_TAMANO(sad_acotada_t, filas, ancho, a, b, paso, filas, ancho, limite);
+}
+
+void copiar(U8 *dst, size_t paso_dst, const U8 *src, size_t paso_src, int filas, int ancho)
+{
+	POR_TAMANO(copiar_t, filas, ancho, dst, paso_dst, src, paso_src, filas, ancho);
+}
+
+} // namespace
+
+void nucleos_comunes::histograma_bancos(const U32 *datos, size_t n, U32 *cuentas, size_t k)
+{
+	// Con pocos datos no compensa inicializar y sumar las tablas auxiliares
+	if (n < 4 * k) {
+		histograma(datos, n, cuentas, k);
+		return;
+	}
+
+	U32 *bancos = new U32[3 * k];
+	memset(bancos, 0, 3 * k * sizeof(U32));
+	U32 *c1 = bancos, *c2 = bancos + k, *c3 = bancos + 2 * k;
+
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		cuentas[datos[i]]++;
+		c1[datos[i + 1]]++;
+		c2[datos[i + 2]]++;
+		c3[datos[i + 3]]++;
+	}
+	for (; i < n; ++i) cuentas[datos[i]]++;
+
+	for (size_t j = 0; j < k; ++j) cuentas[j] += c1[j] + c2[j] + c3[j];
+
+	delete[] bancos;
+}
+
+const cpu::nucleos cpu::nucleos_escalar = { sad, sad_acotada, copiar, histograma };
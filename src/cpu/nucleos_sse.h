@@ -0,0 +1,136 @@
+#ifndef _NUCLEOS_SSE_H_
+#define _NUCLEOS_SSE_H_
+
+#include "cpu/nucleos_comunes.h"
+#include <emmintrin.h>
+#ifdef __SSE4_1__
+	#include <smmintrin.h>
+#endif
+
+// Nucleos con registros de 128 bits. Solo necesitan SSE2 (psadbw), asi que son los mismos
+// para SSE2 y SSE4.1: este fichero se incluye en nucleos_sse2.cc y en nucleos_sse41.cc, cada
+// uno compilado con las opciones de su juego de instrucciones, y con SSE4.1 el compilador
+// puede usar sus instrucciones. Por eso, como en nucleos_comunes.h, todo lo que se define
+// aqui tiene enlace interno.
+
+namespace {
+
+/// Carga 4 bytes sin requisitos de alineamiento.
+inline __m128i cargar4(const U8 *p)
+{
+	int x;
+	memcpy(&x, p, 4);
+	return _mm_cvtsi32_si128(x);
+}
+
+/// Suma los dos contadores de 64 bits que deja psadbw. Con SSE4.1 se extraen directamente.
+inline U32 total(__m128i acc)
+{
+#ifdef __SSE4_1__
+	return _mm_extract_epi32(acc, 0) + _mm_extract_epi32(acc, 2);
+#else
+	return _mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_unpackhi_epi64(acc, acc));
+#endif
+}
+
+/// Acumula en acc la SAD de una fila de n bytes. Los ultimos bytes, que no llenan
+/// un registro, se suman a s.
+inline __m128i sad_fila(const U8 *a, const U8 *b, int n, __m128i acc, U32 &s)
+{
+	int j = 0;
+	for (; j + 16 <= n; j += 16) {
+		__m128i x = _mm_loadu_si128((const __m128i*) (a + j));
+		__m128i y = _mm_loadu_si128((const __m128i*) (b + j));
+		acc = _mm_add_epi64(acc, _mm_sad_epu8(x, y));
+	}
+	if (j + 8 <= n) {
+		__m128i x = _mm_loadl_epi64((const __m128i*) (a + j));
+		__m128i y = _mm_loadl_epi64((const __m128i*) (b + j));
+		acc = _mm_add_epi64(acc, _mm_sad_epu8(x, y));
+		j += 8;
+	}
+	if (j + 4 <= n) {
+		acc = _mm_add_epi64(acc, _mm_sad_epu8(cargar4(a + j), cargar4(b + j)));
+		j += 4;
+	}
+	s += nucleos_comunes::sad_fila(a + j, b + j, n - j);
+	return acc;
+}
+
+template <int F, int A>
+U32 sad_t(const U8 *a, const U8 *b, size_t paso, int filas, int ancho)
+{
+	if (F) {
+		filas = F;
+		ancho = A;
+	}
+
+	// psadbw deja una suma parcial en cada mitad de 64 bits del registro
+	__m128i acc = _mm_setzero_si128();
+	U32 s = 0;
+
+	for (int i = 0; i < filas; ++i, a += paso, b += paso) acc = sad_fila(a, b, ancho, acc, s);
+
+	return s + total(acc);
+}
+
+template <int F, int A>
+U32 sad_acotada_t(const U8 *a, const U8 *b, size_t paso, int filas, int ancho, U32 limite)
+{
+	if (F) {
+		filas = F;
+		ancho = A;
+	}
+
+	__m128i acc = _mm_setzero_si128();
+	U32 s = 0;
+
+	for (int i = 0; i < filas; ++i, a += paso, b += paso) {
+		acc = sad_fila(a, b, ancho, acc, s);
+		if (s + total(acc) > limite) break;
+	}
+
+	return s + total(acc);
+}
+
+template <int F, int A>
+void copiar_t(U8 *dst, size_t paso_dst, const U8 *src, size_t paso_src, int filas, int ancho)
+{
+	if (F) {
+		filas = F;
+		ancho = A;
+	}
+
+	for (int i = 0; i < filas; ++i, dst += paso_dst, src += paso_src) {
+		int j = 0;
+		for (; j + 16 <= ancho; j += 16) {
+			_mm_storeu_si128((__m128i*) (dst + j), _mm_loadu_si128((const __m128i*) (src + j)));
+		}
+		if (j + 8 <= ancho) {
+			_mm_storel_epi64((__m128i*) (dst + j), _mm_loadl_epi64((const __m128i*) (src + j)));
+			j += 8;
+		}
+		memcpy(dst + j, src + j, ancho - j);
+	}
+}
+
+// Versiones de los nucleos de bloques para los tamanos mas comunes (ver nucleos_comunes.h)
+
+U32 sad(const U8 *a, const U8 *b, size_t paso, int filas, int ancho)
+{
+	return POR_TAMANO(sad_t, filas, ancho, a, b, paso, filas, ancho);
+}
+
+U32 sad_acotada(const U8 *a, const U8 *b, size_t paso, int filas, int ancho, U32 limite)
+{
+	return POR_TAMANO(sad_acotada_t, filas, ancho, a, b, paso, filas, ancho, limite);
+}
+
+void copiar(U8 *dst, size_t paso_dst, const U8 *src, size_t paso_src, int filas, int ancho)
+{
+	POR_TAMANO(copiar_t, filas, ancho, dst, paso_dst, src, paso_src, filas, ancho);
+}
+
+} // namespace
+
+#endif // _NUCLEOS_SSE_H_
@@ -0,0 +1,11 @@
+#include "cpu/cpu.h"
+
+#ifdef CPU_X86
+
+#include "cpu/nucleos_sse.h"
+
+// Nucleos para SSE4.1. Se compila con las opciones de ese juego de instrucciones.
+
+const cpu::nucleos cpu::nucleos_sse41 = { sad, sad_acotada, copiar, nucleos_comunes::histograma_bancos };
+
+#endif // CPU_X86
@@ -0,0 +1,106 @@
+#ifndef _BIT_STREAM_HPP
+#define _BIT_STREAM_HPP
+
+#include "../types.h"
+
+namespace huffman {
+
+/// Escribe secuencias de bits en un blob, el bit mas alto de cada byte primero. Los bits se
+/// acumulan en un entero de 64 bits y se escriben de 32 en 32.
+class BitWriter
+{
+	U8* out;
+
+	/// Bits pendientes de escribir, en la parte baja de acc
+	U64 acc;
+	int used;
+
+public:
+
+	/// Empieza a escribir en dst, que debe tener espacio para todos los bits.
+	explicit BitWriter (void* dst) : out((U8*) dst), acc(0), used(0) {}
+
+	/// Escribe los len bits mas bajos de v, el mas alto primero. Pre: len <= 32, v < 2^len
+	/// O(1)
+	void write (U32 v, int len)
+	{
+		acc = (acc << len) | v;
+		used += len;
+		if (used >= 32)
+		{
+			used -= 32;
+			U32 w = (U32) (acc >> used);
+			out[0] = w >> 24;
+			out[1] = w >> 16;
+			out[2] = w >> 8;
+			out[3] = w;
+			out += 4;
+		}
+	}
+
+	/// Escribe los bits pendientes, completando el ultimo byte con ceros.
+	/// Retorna la posicion siguiente al ultimo byte escrito.
+	U8* flush ()
+	{
+		while (used >= 8)
+		{
+			used -= 8;
+			*out++ = (U8) (acc >> used);
+		}
+		if (used > 0) *out++ = (U8) (acc << (8 - used));
+		used = 0;
+		return out;
+	}
+};
+
+
+/// Lee una secuencia de bits escrita por BitWriter. Los siguientes bits estan en la parte
+/// alta de un entero de 64 bits que se rellena byte a byte.
+class BitReader
+{
+	const U8* data;
+	const U8* end;
+
+	U64 buf;
+	int avail;
+
+public:
+
+	/// Empieza a leer los n bits que empiezan en el bit mas alto de d.
+	BitReader (const U8* d, U32 n) : data(d), end(d + (n + 7) / 8), buf(0), avail(0) {}
+
+	/// Rellena el buffer hasta tener al menos 57 bits, o todos los que queden.
+	/// O(1)
+	void refill ()
+	{
+		while (avail <= 56 && data < end)
+		{
+			buf |= (U64) *data++ << (56 - avail);
+			avail += 8;
+		}
+	}
+
+	/// Retorna los siguientes n bits sin consumirlos. Mas alla del final de la secuencia se
+	/// leen ceros. Pre: 0 < n <= 32 y refill llamado despues de consumir los ultimos bits.
+	U32 peek (int n) const { return (U32) (buf >> (64 - n)); }
+
+	/// Consume n bits. Pre: n <= bits en el buffer
+	void skip (int n)
+	{
+		buf <<= n;
+		avail -= n;
+	}
+
+	/// Lee un bit.
+	bool bit ()
+	{
+		if (avail == 0) refill();
+		bool b = (buf >> 63) != 0;
+		skip(1);
+		return b;
+	}
+};
+
+} // namespace huffman end
+
+#endif // _BIT_STREAM_HPP
@@ -0,0 +1,245 @@
+#ifndef _HUFFMAN_CODE_HPP
+#define _HUFFMAN_CODE_HPP
+
+#include "cpu/cpu.h"
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <queue>
+#include <utility>
+#include <vector>
+
+namespace huffman {
+
+/// Bits que el decodificador resuelve con una consulta a su tabla (ver length_limit). Con 13
+/// la tabla cabe en la cache L2 y acortar los codigos largos apenas cuesta compresion.
+static const int table_bits = 13;
+
+/// Longitud que ningun codigo puede superar: los codigos se leen en enteros de 32 bits.
+static const int max_code_length = 32;
+
+
+/// Longitud maxima de los codigos de un alfabeto de k elementos: table_bits, o la justa para
+/// que quepan los k si no caben en table_bits bits. Asi la tabla del decodificador resuelve
+/// cualquier codigo de una vez, y no pasa de 2^table_bits entradas o 2k.
+inline int length_limit (size_t k)
+{
+	int limit = table_bits;
+	while (((U64) 1 << limit) < k) limit++;
+	return limit;
+}
+
+
+/// Cuenta las apariciones de cada elemento de la secuencia en el mapa dado.
+/// O(nlogn)
+template <class T, class iter_t>
+void count_frequencies (std::map<T,int>& freqs, iter_t begin, const iter_t& end)
+{
+	for (; begin != end; ++begin) freqs[*begin]++;
+}
+
+
+/// Construye un mapa de frequencias.
+/// O(nlogn)
+template <class T, class iter_t>
+std::map<T,int> compute_frequencies (iter_t begin, const iter_t& end)
+{
+	std::map<T,int> freqs;
+	count_frequencies (freqs, begin, end);
+	return freqs;
+}
+
+
+/// Reune los elementos distintos de la secuencia, en orden creciente, y sus apariciones.
+/// O(nlogn)
+template <class T, class iter_t>
+void count_symbols (iter_t begin, const iter_t& end, std::vector<T>& alphabet, std::vector<U32>& counts)
+{
+	typedef std::map<T,int> frequency_map;
+	frequency_map freqs = compute_frequencies<T>(begin, end);
+	for (typename frequency_map::const_iterator it = freqs.begin(); it != freqs.end(); ++it)
+	{
+		alphabet.push_back(it->first);
+		counts.push_back(it->second);
+	}
+}
+
+
+/// Cierto si los enteros de una secuencia de n, hasta max, son densos: el mayor no es mucho
+/// mayor que la longitud de la secuencia, asi que se pueden indexar en arrays.
+inline bool dense (U32 max, size_t n)
+{
+	return (size_t) max + 1 <= 2 * n + 256;
+}
+
+
+/// Cierto si la tabla del alfabeto dado (en orden creciente) ocupa menos guardando un byte por
+/// cada valor de 0 al mayor, con 0 para los que no aparecen, que guardando los elementos en 4
+/// bytes cada uno. Ademas de ese byte o de esos 4, cada elemento lleva su longitud de codigo
+/// (en huffman) o su frecuencia (en rANS).
+inline bool dense_table (const std::vector<U32>& alphabet)
+{
+	return !alphabet.empty() && (U64) alphabet.back() + 1 <= 5 * (U64) alphabet.size();
+}
+
+
+/// Para otros tipos de elemento el alfabeto siempre se guarda entero.
+template <class T>
+bool dense_table (const std::vector<T>&)
+{
+	return false;
+}
+
+
+/// Version para secuencias contiguas de enteros. Si los valores son densos se cuentan con el
+/// nucleo de histograma, sin pasar por ningun mapa.
+/// O(n + k) con valores densos, donde k es el mayor valor de la secuencia.
+inline void count_symbols (U32* begin, U32* end, std::vector<U32>& alphabet, std::vector<U32>& counts)
+{
+	size_t n = end - begin;
+	U32 max = 0;
+	for (U32* it = begin; it != end; ++it) if (*it > max) max = *it;
+
+	if (n == 0 || !dense(max, n))
+	{
+		count_symbols<U32, U32*> (begin, end, alphabet, counts);
+		return;
+	}
+
+	size_t k = (size_t) max + 1;
+	std::vector<U32> hist(k, 0);
+	cpu::nucleo.histograma(begin, n, &hist[0], k);
+	for (size_t v = 0; v < k; ++v)
+	{
+		if (hist[v])
+		{
+			alphabet.push_back(v);
+			counts.push_back(hist[v]);
+		}
+	}
+}
+
+
+/// Calcula la longitud del codigo de Huffman de cada elemento a partir de sus frecuencias, sin
+/// pasar de limit bits. Si el codigo optimo tiene codigos mas largos se acortan, alargando
+/// los de los elementos menos frecuentes hasta que vuelven a caber. Un elemento solo recibe
+/// un codigo de 1 bit. Pre: freqs no vacio, freqs.size() <= 2^limit
+/// O(nlogn)
+inline void code_lengths (const std::vector<U32>& freqs, int limit, std::vector<U8>& lengths)
+{
+	size_t k = freqs.size();
+	lengths.assign(k, 1);
+	if (k == 1) return;
+	
+	// Arbol de Huffman en arrays: las hojas son los elementos y cada nodo interno se crea con
+	// una posicion mayor que la de sus hijos, asi que las profundidades salen en un recorrido
+	typedef std::pair<U64,U32> qelem;
+	std::priority_queue< qelem, std::vector<qelem>, std::greater<qelem> > q;
+	for (size_t i = 0; i < k; ++i) q.push(std::make_pair((U64) freqs[i], (U32) i));
+	
+	std::vector<U32> parent(2 * k - 1);
+	U32 next = k;
+	while (q.size() > 1)
+	{
+		qelem p1 = q.top();
+		q.pop();
+		qelem p2 = q.top();
+		q.pop();
+		
+		parent[p1.second] = parent[p2.second] = next;
+		q.push(std::make_pair(p1.first + p2.first, next));
+		next++;
+	}
+	
+	std::vector<U32> depth(2 * k - 1, 0);
+	std::vector<U32> count(k, 0);
+	int longest = 0;
+	for (size_t n = 2 * k - 2; n-- > 0;)
+	{
+		depth[n] = depth[parent[n]] + 1;
+		if (n < k)
+		{
+			count[depth[n]]++;
+			if ((int) depth[n] > longest) longest = depth[n];
+		}
+	}
+	
+	if (longest <= limit)
+	{
+		for (size_t i = 0; i < k; ++i) lengths[i] = depth[i];
+		return;
+	}
+	
+	// Los codigos largos pasan a tener limit bits y sobran codigos: cada vuelta quita uno de
+	// limit bits y parte uno mas corto en dos de un bit mas, hasta que la suma de Kraft es 1
+	count.resize(longest + 1);
+	for (int l = limit + 1; l <= longest; ++l) count[limit] += count[l];
+	U64 total = 0;
+	for (int l = 1; l <= limit; ++l) total += (U64) count[l] << (limit - l);
+	while (total > ((U64) 1 << limit))
+	{
+		count[limit]--;
+		for (int l = limit - 1; l > 0; --l)
+		{
+			if (count[l])
+			{
+				count[l]--;
+				count[l + 1] += 2;
+				break;
+			}
+		}
+		total--;
+	}
+	
+	// Los codigos mas cortos son para los elementos mas frecuentes
+	std::vector<U32> order(k);
+	for (size_t i = 0; i < k; ++i) order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&freqs](U32 a, U32 b) { return freqs[a] > freqs[b]; });
+	size_t i = 0;
+	for (int l = 1; l <= limit; ++l)
+	{
+		for (U32 c = 0; c < count[l]; ++c) lengths[order[i++]] = l;
+	}
+}
+
+
+/// Calcula el primer codigo canonico de cada longitud y cuantos codigos hay de cada una, a
+/// partir de las longitudes dadas. Los codigos de cada longitud son consecutivos desde first[l].
+/// Lanza una excepcion si las longitudes no son validas. first y count tienen
+/// max_code_length + 1 posiciones.
+/// O(n)
+inline void first_codes (const std::vector<U8>& lengths, U32* first, U32* count)
+{
+	for (int l = 0; l <= max_code_length; ++l) count[l] = 0;
+	for (size_t i = 0; i < lengths.size(); ++i)
+	{
+		if (lengths[i] == 0 || lengths[i] > max_code_length) throw "huffman: invalid code length";
+		count[lengths[i]]++;
+	}
+	
+	U64 code = 0;
+	first[0] = 0;
+	for (int l = 1; l <= max_code_length; ++l)
+	{
+		code = (code + count[l-1]) << 1;
+		if (code + count[l] > ((U64) 1 << l)) throw "huffman: invalid code length";
+		first[l] = (U32) code;
+	}
+}
+
+
+/// Calcula los codigos canonicos de las longitudes dadas: los de cada longitud se reparten en
+/// el orden de los elementos.
+/// O(n)
+inline void canonical_codes (const std::vector<U8>& lengths, std::vector<U32>& codes)
+{
+	U32 first[max_code_length + 1], count[max_code_length + 1];
+	first_codes(lengths, first, count);
+	
+	codes.resize(lengths.size());
+	for (size_t i = 0; i < lengths.size(); ++i) codes[i] = first[lengths[i]]++;
+}
+
+} // namespace huffman end
+
+#endif // _HUFFMAN_CODE_HPP
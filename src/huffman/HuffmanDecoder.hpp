@@ -0,0 +1,101 @@
+#ifndef _HUFFMAN_DECODER_HPP
+#define _HUFFMAN_DECODER_HPP
+
+#include "BitStream.hpp"
+#include "HuffmanCode.hpp"
+#include "../types.h"
+#include <vector>
+
+namespace huffman {
+
+/// Decodificador de codigos canonicos. Lee los bits directamente de la secuencia serializada,
+/// con un BitReader, y resuelve cada codigo con una consulta a una tabla indexada por los
+/// siguientes bits: da el simbolo del codigo con el que empiezan y su longitud. La tabla tiene
+/// tantos bits como el codigo mas largo, que encode limita a length_limit (ver HuffmanCode.hpp).
+template <class T>
+class HuffmanDecoder
+{
+	/// Entrada de la tabla: value es la posicion en symbols del codigo de len bits con el que
+	/// empiezan los bits. Con len = invalid, los bits no son el principio de ningun codigo.
+	struct entry
+	{
+		U32 value;
+		U8 len;
+	};
+
+	static const U8 invalid = 0xff;
+
+	/// Elementos en orden canonico: por longitud de codigo y, con la misma, en orden de entrada.
+	std::vector<T> symbols;
+	std::vector<entry> table;
+
+	/// Bits de la tabla: la longitud del codigo mas largo.
+	int bits;
+
+public:
+
+	/// Construye el decodificador de los elementos dados con las longitudes de codigo dadas.
+	/// Lanza una excepcion si las longitudes no son validas o pasan de length_limit.
+	/// O(n + 2^bits)
+	HuffmanDecoder (const std::vector<T>& alphabet, const std::vector<U8>& lengths)
+	{
+		U32 first[max_code_length + 1], count[max_code_length + 1], offset[max_code_length + 1];
+		first_codes(lengths, first, count);
+
+		offset[0] = 0;
+		bits = 0;
+		for (int l = 1; l <= max_code_length; ++l)
+		{
+			offset[l] = offset[l-1] + count[l-1];
+			if (count[l]) bits = l;
+		}
+		if (bits > length_limit(alphabet.size())) throw "huffman: invalid code length";
+
+		// Ordenacion por cuentas: los de cada longitud quedan en el orden de entrada
+		U32 pos[max_code_length + 1];
+		for (int l = 0; l <= max_code_length; ++l) pos[l] = offset[l];
+		symbols.resize(alphabet.size());
+		for (size_t i = 0; i < alphabet.size(); ++i) symbols[pos[lengths[i]]++] = alphabet[i];
+
+		// Cada codigo ocupa todas las entradas que empiezan por el. Las que sobran, si el
+		// codigo no es completo, no son de ninguno.
+		entry e = { 0, invalid };
+		table.assign((size_t) 1 << bits, e);
+		for (int l = 1; l <= bits; ++l)
+		{
+			for (U32 j = 0; j < count[l]; ++j)
+			{
+				entry s = { offset[l] + j, (U8) l };
+				size_t span = (size_t) 1 << (bits - l);
+				size_t start = (size_t) (first[l] + j) << (bits - l);
+				for (size_t v = start; v < start + span; ++v) table[v] = s;
+			}
+		}
+	}
+
+	/// Decodifica los n bits que empiezan en el bit mas alto de data y anade los simbolos a cont.
+	/// O(n)
+	template <class cont_t>
+	void decode (const U8* data, U32 n, cont_t& cont) const
+	{
+		if (n > 0 && bits == 0) throw "decode: invalid code";
+
+		BitReader r(data, n);
+		U64 left = n;
+
+		while (left > 0)
+		{
+			r.refill();
+			entry e = table[r.peek(bits)];
+			if (e.len == invalid || (U64) e.len > left) throw "decode: invalid code";
+
+			cont.push_back(symbols[e.value]);
+			r.skip(e.len);
+			left -= e.len;
+		}
+	}
+};
+
+} // namespace huffman end
+
+#endif // _HUFFMAN_DECODER_HPP
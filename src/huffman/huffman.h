@@ -23,87 +23,107 @@ void decode (const void* blob, size_t size, cont_t& cont);
 
 
 /// API privada.
-#include "HuffmanTree.hpp"
+#include "BitStream.hpp"
+#include "HuffmanCode.hpp"
+#include "HuffmanDecoder.hpp"
+#include <map>
 #include <vector>
-#include <cstdlib>
-#include <string>
 
 namespace huffman {
 
 enum num_type { num_byte, num_word, num_dword };
 
-/// Codifica la secuencia dada con la tabla de Huffman dada.
-template <class T, class iter_t, class cont_t>
-void encode_seq (iter_t begin, const iter_t& end, const std::map< T,std::vector<bool> >& table, cont_t& cont)
+/// Como se guarda la tabla: con el alfabeto y la longitud de cada elemento, o con la longitud
+/// de cada valor de 0 al mayor (ver dense_table).
+enum table_type { table_sparse, table_dense };
+
+/// Codifica la secuencia dada con los codigos y longitudes dados para cada elemento del alfabeto.
+/// O(nlogk)
+template <class T, class iter_t>
+void encode_seq (iter_t begin, const iter_t& end, const std::vector<T>& alphabet,
+				 const std::vector<U32>& codes, const std::vector<U8>& lengths, BitWriter& w)
 {
+	std::map< T,std::pair<U32,int> > table;
+	for (size_t i = 0; i < alphabet.size(); ++i)
+	{
+		table.insert(table.end(), std::make_pair(alphabet[i], std::make_pair(codes[i], (int) lengths[i])));
+	}
+	
 	for (; begin != end; ++begin)
 	{
-		const std::vector<bool>& c = table.find(*begin)->second;
-		for (size_t i = 0; i < c.size(); ++i) cont.push_back(c[i]);
+		const std::pair<U32,int>& c = table.find(*begin)->second;
+		w.write(c.first, c.second);
 	}
 }
 
 
-inline std::string hf_to_string (const std::vector<bool>& code)
+/// Version para secuencias contiguas de enteros. Si los valores son densos, los codigos se
+/// buscan en un array indexado por el valor en lugar de en un mapa.
+/// O(n + k) con valores densos, donde k es el mayor valor de la secuencia.
+inline void encode_seq (U32* begin, U32* end, const std::vector<U32>& alphabet,
+						const std::vector<U32>& codes, const std::vector<U8>& lengths, BitWriter& w)
 {
-	std::string s;
-	for (size_t i = 0; i < code.size(); ++i) s += (code[i] + 0x30);
-	return s;
-}
-
-
-/// Decodifica la secuencia dada con la tabla de Huffman dada.
-template <class T, class iter_t, class cont_t>
-void decode_seq (const iter_t& begin, const iter_t& end, const std::map< T,std::vector<bool> >& table, cont_t& cont)
-{
-	HuffmanTree<T> tree(table);
-	tree.decode (begin, end, cont);
+	if (alphabet.empty() || !dense(alphabet.back(), end - begin))
+	{
+		encode_seq<U32, U32*> (begin, end, alphabet, codes, lengths, w);
+		return;
+	}
+	
+	std::vector< std::pair<U32,int> > table(alphabet.back() + 1);
+	for (size_t i = 0; i < alphabet.size(); ++i) table[alphabet[i]] = std::make_pair(codes[i], (int) lengths[i]);
+	
+	for (; begin != end; ++begin)
+	{
+		const std::pair<U32,int>& c = table[*begin];
+		w.write(c.first, c.second);
+	}
 }
 
 
-/// Rota el I8 dado 1 bit a la derecha.
-U8 rotate_right (U8 c);
-
-
-/// Escribe un valor de tipo T en el blob dado.
+/// Escribe un valor de tipo T en el blob dado, sin requisitos de alineamiento.
 /// Retorna la nueva posicion en el blob.
 template <class T>
 void* write_num (void* blob, T val)
 {
-	T* ptr = (T*) blob;
-	*ptr = val;
-	ptr++;
-	return (void*) ptr;
+	memcpy (blob, &val, sizeof(T));
+	return (U8*) blob + sizeof(T);
 }
 
 
-/// Lee un valor de tipo T del blob dado.
+/// Lee un valor de tipo T del blob dado, sin requisitos de alineamiento.
 /// Retorna la nueva posicion en el blob.
 template <class T>
 const void* read_num(const void* blob, T& val)
 {
-	T* ptr = (T*) blob;
-	val = *ptr;
-	ptr++;
-	return (void*) ptr;
+	memcpy (&val, blob, sizeof(T));
+	return (const U8*) blob + sizeof(T);
 }
 
 
-/// Serializa la secuencia de bits dada.
-template <class iter_t>
-std::pair<void*,size_t> serialise_seq (iter_t begin, size_t n)
+/// Tamanyo en bytes de un contador n serializado con write_count.
+inline size_t count_size (U32 n)
 {
-	U8* seq;
-	size_t s = n / 8 + ((n % 8) != 0) + 1;
-	
-	if (n <= 255)			s += 1;
-	else if (n <= 65535)	s += 2;
-	else					s += 4;
-	
-	seq = new U8[s];
-	memset (seq, 0, s);
-	
-	U8* cptr = (U8*) seq;
+	if (n <= 255)			return 2;
+	else if (n <= 65535)	return 3;
+	else					return 5;
+}
+
+
+/// Cierto si los s bytes del blob dado tienen sitio para el contador escrito con write_count
+/// que empieza en el, segun su num_type.
+inline bool count_fits (const void* blob, size_t s)
+{
+	if (s < 2) return false;
+	U8 nt = *(const U8*) blob;
+	return s >= (nt == num_dword ? 5 : nt == num_word ? 3 : 2);
+}
+
+
+/// Escribe en el blob dado el contador n, precedido del num_type con el que se escribe.
+/// Retorna la nueva posicion en el blob.
+inline U8* write_count (void* blob, U32 n)
+{
+	U8* cptr = (U8*) blob;
 	
 	if (n <= 255)
 	{
@@ -124,354 +144,211 @@ std::pair<void*,size_t> serialise_seq (iter_t begin, size_t n)
 		cptr = (U8*) write_num<U32> (cptr, n);
 	}
 	
-	U8 mask = 0x80;
-	for (size_t i = 0; i < n; ++i)
-	{
-		if (*begin) cptr[i/8] |= mask;
-		mask = rotate_right (mask);
-		++begin;
-	}
-	
-	return std::make_pair (seq, s);
-}
-
-
-/// Deserializa el I8 dado.
-template <class cont_t>
-void deserialise_I8 (U8 c, U32 n, cont_t& cont)
-{
-	U8 mask = 0x80;
-	for (U32 i = 0; i < n; ++i)
-	{
-		bool b = !(!(c & mask));
-		cont.push_back (b);
-		mask = mask >> 1;
-	}
+	return cptr;
 }
 
 
-/// Deserializa el blob dado como una secuencia de bits.
-/// Avanza el puntero dado hasta la nueva posicion.
-/// Devuelve la cantidad de bits en la secuencia.
-template <class cont_t>
-U32 deserialise_seq (void** ptr, cont_t& cont)
+/// Lee del blob dado un contador escrito con write_count.
+/// Retorna la nueva posicion en el blob.
+inline const U8* read_count (const void* blob, U32& n)
 {
-	const U8* cptr = (const U8*) *ptr;
+	const U8* cptr = (const U8*) blob;
 	num_type nt = (num_type) *cptr;
 	cptr++;
 	
-	U32 n;
-	if (nt == num_byte)
-	{
-		U8 nbyte;
-		cptr = (const U8*) read_num<U8> (cptr, nbyte);
-		n = nbyte;
-	}
-	else if (nt == num_word)
-	{
-		U16 nword;
-		cptr = (const U8*) read_num<U16> (cptr, nword);
-		n = nword;
-	}
-	else
-	{
-		U32 ndword;
-		cptr = (const U8*) read_num<U32> (cptr, ndword);
-		n = ndword;
-	}
-	
-	U32 count = n;
-	while (count != 0)
+	switch (nt)
 	{
-		U32 s = count > 8 ? 8 : count;
-		deserialise_I8 (*cptr, s, cont);
-		count -= s;
-		cptr++;
+		case num_byte:
+			U8 nbyte;
+			cptr = (const U8*) read_num<U8> (cptr, nbyte);
+			n = nbyte;
+			break;
+			
+		case num_word:
+			U16 nword;
+			cptr = (const U8*) read_num<U16> (cptr, nword);
+			n = nword;
+			break;
+			
+		case num_dword:
+			U32 ndword;
+			cptr = (const U8*) read_num<U32> (cptr, ndword);
+			n = ndword;
+			break;
+			
+		default:
+			throw "read_count: invalid num type";
 	}
 	
-	*ptr = (void*) cptr;
-	
-	return n;
+	return cptr;
 }
 
 
-/// Convierte la tabla dada en arrays de alphabeto, bits de codificacion e indices.
+/// Tamanyo en bytes de la tabla serializada del alfabeto dado, de elementos de tipo T.
 template <class T>
-void make_arrays (const std::map< T,std::vector<bool> >& table, std::vector<T>& alphabet,
-				  std::vector<bool>& alphabits, std::vector<I32>& idxs)
+size_t table_size (const std::vector<T>& alphabet)
 {
-	typedef std::map< T,std::vector<bool> > table_t;
-	I32 idx = 0;
-	BOOST_FOREACH (const typename table_t::value_type& keyval, table)
-	{
-		alphabet.push_back(keyval.first);
-		idxs.push_back(idx);
-		for (size_t i = 0; i < keyval.second.size(); ++i) alphabits.push_back(keyval.second[i]);
-		idx += keyval.second.size();
-	}
-	idxs.push_back(idx);
+	U32 k = alphabet.size();
+	if (dense_table (alphabet)) return 1 + count_size (alphabet.back() + 1) + alphabet.back() + 1;
+	return 1 + count_size (k) + (sizeof(T) + 1) * k;
 }
 
 
-/// Convierte los arrays de alphabeto, bits de codificacion e indices dados en una tabla de Huffman.
-template <class T>
-std::map< T,std::vector<bool> > make_table (const std::vector<T>& alphabet, const std::vector<bool>& alphabits,
-											const std::vector<I32>& idxs)
+/// Escribe en cptr la longitud de codigo de cada valor de 0 a m-1, 0 para los que no estan en
+/// el alfabeto. Retorna la nueva posicion en el blob.
+inline U8* write_dense (U8* cptr, U32 m, const std::vector<U32>& alphabet, const std::vector<U8>& lengths)
 {
-	std::map< T,std::vector<bool> > table;
-	for (size_t i = 0; i < alphabet.size(); ++i)
-	{
-		std::vector<bool> bits;
-		for (I32 j = idxs[i]; j < idxs[i+1]; ++j) bits.push_back(alphabits[j]);
-		table[alphabet[i]] = bits;
-	}
-	return table;
+	memset (cptr, 0, m);
+	for (size_t i = 0; i < alphabet.size(); ++i) cptr[alphabet[i]] = lengths[i];
+	return cptr + m;
 }
 
 
-/// Copia la secuencia de enteros dada en el blob dado casteados al tipo T.
-template <class T, class iter_t>
-void* write_nums (iter_t begin, const iter_t& end, void* blob)
+/// Lee de cptr las longitudes escritas con write_dense, dejando en el alfabeto los valores
+/// que tienen codigo.
+inline void read_dense (const U8* cptr, U32 m, std::vector<U32>& alphabet, std::vector<U8>& lengths)
 {
-	T* ptr = (T*) blob;
-	for (; begin != end; ++begin)
+	alphabet.clear();
+	lengths.clear();
+	for (U32 v = 0; v < m; ++v)
 	{
-		*ptr = (T)(*begin);
-		ptr++;
+		if (cptr[v] == 0) continue;
+		alphabet.push_back(v);
+		lengths.push_back(cptr[v]);
 	}
-	return (void*) ptr;
 }
 
 
-/// Lee la secuencia de enteros dada del blob dado, representados como valores de tipo T.
-template <class T, class cont_t>
-void* read_nums (const void* blob, size_t n, cont_t& cont)
+/// Solo los alfabetos de enteros se guardan densos (ver dense_table).
+template <class T>
+U8* write_dense (U8* cptr, U32, const std::vector<T>&, const std::vector<U8>&)
 {
-	const T* ptr = (const T*) blob;
-	for (size_t i = 0; i < n; ++i)
-	{
-		cont.push_back(*ptr);
-		ptr++;
-	}
-	return (void*) ptr;
+	return cptr;
 }
 
 
-/// Serializa los arrays de alphabeto, bits de codificacion e indices dados.
 template <class T>
-std::pair<void*,size_t> serialise (std::vector<T>& alphabet, std::vector<bool>& alphabits, std::vector<I32>& idxs)
+void read_dense (const U8*, U32, std::vector<T>&, std::vector<U8>&)
 {
-	// Cabecera:
-	// [0-3]
-	// byte 0:          num_type - El tamanyo del entero que representa el numero de elementos.
-	// bytes 1-{2,3,4}: numero de elementos en el alfabeto (tambien es el numero de indices en el vector idxs).
-	
-	// Serializar los bits del alphabeto.
-	std::pair<void*,size_t> serial_alphabits = serialise_seq (alphabits.begin(), alphabits.size());
-	
-	// Calcular el tipo numerico a utilizar y calcular tamanyo del buffer.
-	U32 n = alphabet.size();
-	num_type nt;
-	size_t s = serial_alphabits.second + sizeof(T) * alphabet.size() + 1;
-	if (n <= 255)
-	{
-		nt = num_byte;
-		s = s + idxs.size() + 1;
-	}
-	else if (n <= 65535)
-	{
-		nt = num_word;
-		s = s + idxs.size() * 2 + 2;
-	}
-	else
-	{
-		nt = num_dword;
-		s = s + idxs.size() * 4 + 4;
-	}
-	
-	// Crear buffer para los datos.
-	// size_t s = serial_alphabits.second + sizeof(T) * alphabet.size() + sizeof(I32) * idxs.size() + sizeof(I32);
-	I8* buf = new I8[s];
-	
-	// Copiar el tamanyo del numero de elementos.
-	U8* ntype = (U8*) buf;
-	*ntype = nt;
-	ntype++;
-	
-	// Copiar el numero de elementos en el alphabeto.
-	I8* nelems = (I8*) ntype;
-	switch (nt)
-	{
-		case num_byte:
-			nelems = (I8*) write_num<U8> (nelems, alphabet.size());
-			break;
-			
-		case num_word:
-			nelems = (I8*) write_num<U16> (nelems, alphabet.size());
-			break;
-			
-		case num_dword:
-			nelems = (I8*) write_num<U32> (nelems, alphabet.size());
-			break;
-	}
-	
-	// Copiar el alfabeto en el buffer.
-	T* tptr = (T*) nelems;
-	memcpy (tptr, &alphabet[0], sizeof(T) * alphabet.size());
-	
-	// Copiar alphabits serializados.
-	I8* cptr = (I8*) tptr + sizeof(T) * alphabet.size();
-	memcpy (cptr, serial_alphabits.first, serial_alphabits.second);
+	throw "deserialise: invalid table type";
+}
+
+
+/// Serializa en el blob dado el alfabeto y las longitudes de codigo dados.
+/// Retorna la nueva posicion en el blob.
+template <class T>
+U8* serialise (void* blob, const std::vector<T>& alphabet, const std::vector<U8>& lengths)
+{
+	// Tabla:
+	// byte 0:          table_type.
+	// Si es table_sparse:
+	// bytes 1-{2,3,5}: num_type y numero de elementos en el alfabeto.
+	// k * sizeof(T):   el alfabeto, en orden creciente.
+	// k:               la longitud del codigo de cada elemento.
+	// Si es table_dense:
+	// bytes 1-{2,3,5}: num_type y numero de valores m, el mayor del alfabeto mas 1.
+	// m:               la longitud del codigo de cada valor de 0 a m-1, 0 si no esta.
+	// Los codigos son los canonicos.
+	U8* cptr = (U8*) blob;
+	U32 k = alphabet.size();
+	bool dense = dense_table (alphabet);
+	*cptr++ = dense ? table_dense : table_sparse;
 	
-	// Copiar indices.
-	void* vptr = (void*) (cptr + serial_alphabits.second);
-	switch (nt)
+	if (dense)
 	{
-		case num_byte:
-			write_nums<U8> (idxs.begin(), idxs.end(), vptr);
-			break;
-			
-		case num_word:
-			write_nums<U16> (idxs.begin(), idxs.end(), vptr);
-			break;
-		
-		case num_dword:
-			write_nums<U32> (idxs.begin(), idxs.end(), vptr);
-			break;
+		U32 m = alphabet.back() + 1;
+		return write_dense (write_count (cptr, m), m, alphabet, lengths);
 	}
 	
-	delete[] (char*)serial_alphabits.first;
+	cptr = write_count (cptr, k);
+	if (k == 0) return cptr;
 	
-	return std::make_pair (buf, s);
+	memcpy (cptr, &alphabet[0], sizeof(T) * k);
+	cptr += sizeof(T) * k;
+	memcpy (cptr, &lengths[0], k);
+	return cptr + k;
 }
 
 
-/// Deserializa el blob dado en arrays de alphabeto, bits de codificacion e indices.
+/// Deserializa el blob dado, de s bytes, en el alfabeto y las longitudes de codigo.
 /// Retorna el numero de bytes procesados.
 template <class T>
-I32 deserialise (const void* blob, size_t s, std::vector<T>& alphabet, std::vector<bool>& alphabits,
-				  std::vector<I32>& idxs)
+size_t deserialise (const void* blob, size_t s, std::vector<T>& alphabet, std::vector<U8>& lengths)
 {
-	// Sacar el tipo numerico del numero de elementos.
-	const I8* cptr = (const I8*) blob;
-	num_type nt = (num_type) *cptr;
-	cptr++;
+	const U8* cptr = (const U8*) blob;
+	const U8* end = cptr + s;
+	if (s < 2) throw "deserialise: truncated table";
+	U8 type = *cptr++;
+	if (type != table_sparse && type != table_dense) throw "deserialise: invalid table type";
+	if (!count_fits (cptr, s - 1)) throw "deserialise: truncated table";
+	U32 k;
+	cptr = read_count (cptr, k);
 	
-	// Sacar el numero de elementos en el alphabeto (tambien es el numero de indices).
-	U32 n;
-	switch (nt)
+	if (type == table_dense)
 	{
-		case num_byte:
-			U8 nI8;
-			cptr = (const I8*) read_num<U8> (cptr, nI8);
-			n = nI8;
-			break;
-			
-		case num_word:
-			U16 nword;
-			cptr = (const I8*) read_num<U16> (cptr, nword);
-			n = nword;
-			break;
-			
-		case num_dword:
-			U32 ndword;
-			cptr = (const I8*) read_num<U32> (cptr, ndword);
-			n = ndword;
-			break;
+		if (k > (size_t) (end - cptr)) throw "deserialise: truncated table";
+		read_dense (cptr, k, alphabet, lengths);
+		return cptr + k - (const U8*) blob;
 	}
 	
-	// Sacar el alphabeto.
-	const T* tptr = (const T*) cptr;
-	for (U32 i = 0; i < n; ++i)
-	{
-		alphabet.push_back(*tptr);
-		tptr++;
-	}
+	if ((sizeof(T) + 1) * (U64) k > (size_t) (end - cptr)) throw "deserialise: truncated table";
 	
-	// Sacar la secuencia de bits.
-	U32 nbits = deserialise_seq ((void**)&tptr, alphabits);
+	alphabet.resize(k);
+	lengths.resize(k);
+	if (k == 0) return cptr - (const U8*) blob;
 	
-	// Sacar los indices.
-	const void* vptr = (const void*) tptr;
-	switch (nt)
-	{
-		case num_byte:
-			read_nums<U8> (vptr, n+1, idxs);
-			return (const I8*) vptr + n+1 - (const I8*) blob;
-		
-		case num_word:
-			read_nums<U16> (vptr, n+1, idxs);
-			return (const I8*) vptr + 2 * (n+1) - (const I8*) blob;
-		
-		case num_dword:
-			read_nums<U32> (vptr, n+1, idxs);
-			return (const I8*) vptr + 4 * (n+1) - (const I8*) blob;
-			
-		default:
-			break;
-	}
-	
-	throw "deserialise: invalid num type";
+	memcpy (&alphabet[0], cptr, sizeof(T) * k);
+	cptr += sizeof(T) * k;
+	memcpy (&lengths[0], cptr, k);
+	return cptr + k - (const U8*) blob;
 }
 
 
-/// Serializa la tabla de Huffman y la secuencia de bits dados.
-template <class T>
-std::pair<void*,size_t> serialise (const std::map< T,std::vector<bool> >& table, const std::vector<bool>& code)
+template <class T, class iter_t>
+std::pair<void*,size_t> encode (iter_t begin, const iter_t& end)
 {
-	std::vector<T>    alphabet;
-	std::vector<bool> alphabits;
-	std::vector<I32>  idxs;
-	make_arrays (table, alphabet, alphabits, idxs);
+	std::vector<T>   alphabet;
+	std::vector<U32> counts;
+	count_symbols (begin, end, alphabet, counts);
 	
-	std::pair<void*,size_t> serial_code = serialise_seq (code.begin(), code.size());
-	std::pair<void*,size_t> serial_tree = serialise (alphabet, alphabits, idxs);
+	// Los codigos se limitan para que el decodificador los resuelva todos con su tabla
+	U32 k = alphabet.size();
+	std::vector<U8>  lengths;
+	std::vector<U32> codes;
+	if (k > 0) code_lengths (counts, length_limit (k), lengths);
+	canonical_codes (lengths, codes);
 	
-	size_t s = serial_code.second + serial_tree.second;
-	I8* buf = new I8[s];
+	U64 n = 0;
+	for (U32 i = 0; i < k; ++i) n += (U64) counts[i] * lengths[i];
+	if (n > 0xffffffff) throw "encode: sequence too long";
 	
-	memcpy (buf, serial_tree.first, serial_tree.second);
-	memcpy (buf + serial_tree.second, serial_code.first, serial_code.second);
+	// Tabla y secuencia de bits, escrita directamente en el blob
+	size_t s = table_size (alphabet) + count_size (n) + (n + 7) / 8;
+	U8* buf = new U8[s];
+	
+	BitWriter w(write_count (serialise (buf, alphabet, lengths), n));
+	encode_seq (begin, end, alphabet, codes, lengths, w);
+	w.flush ();
 	
-	delete[] (char*)serial_tree.first;
-	delete[] (char*)serial_code.first;
 	return std::make_pair (buf, s);
 }
 
 
-/// Deserializa el blob dado en una tabla de Huffman y una secuencia de bits.
-template <class T>
-void deserialise (const void* blob, size_t s,
-				  std::map< T,std::vector<bool> >& table, std::vector<bool>& code)
-{
-	std::vector<T>    alphabet;
-	std::vector<bool> alphabits;
-	std::vector<I32>  idxs;
-	I32 pos = deserialise (blob, s, alphabet, alphabits, idxs);
-	table = make_table (alphabet, alphabits, idxs);
-	const void* ptr = (const void*) ((const I8*) blob + pos);
-	deserialise_seq ((void**)&ptr, code);
-}
-
-
-template <class T, class iter_t>
-std::pair<void*,size_t> encode (iter_t begin, const iter_t& end)
-{
-	HuffmanTree<T> t(begin, end);
-	std::map< T,std::vector<bool> > table = t.make_table();
-	std::vector<bool> code;
-	encode_seq (begin, end, table, code);
-	return serialise<T> (table, code);
-}
-
-
 template <class T, class cont_t>
 void decode (const void* blob, size_t size, cont_t& cont)
 {
-	std::map< T,std::vector<bool> > table;
-	std::vector<bool> code;
-	deserialise (blob, size, table, code);
-	decode_seq (code.begin(), code.end(), table, cont);
+	std::vector<T>  alphabet;
+	std::vector<U8> lengths;
+	size_t pos = deserialise (blob, size, alphabet, lengths);
+	
+	// Los bits del codigo se leen directamente del blob, despues de su numero
+	if (!count_fits ((const U8*) blob + pos, size - pos)) throw "decode: truncated sequence";
+	U32 n;
+	const U8* bits = read_count ((const U8*) blob + pos, n);
+	if (bits + (n + 7) / 8 > (const U8*) blob + size) throw "decode: truncated sequence";
+	
+	HuffmanDecoder<T> decoder(alphabet, lengths);
+	decoder.decode (bits, n, cont);
 }
 
 } // namespace huffman end
@@ -4,24 +4,105 @@
 #include <vector>
 #include <utility>
 #include <fstream>
-#include "Pixel.h"
+#include <chrono>
+#include <cstdlib>
+#include <thread>
 #include "ppm/io.h"
 #include "ppm/ppm.h"
 #include "Matriz.hpp"
 #include "compr/zipfuncs.h"
+#include "cpu/cpu.h"
 #include "types.h"
 
 using namespace std;
 
 double alpha = 100.0;
 
+// Como se buscan los bloques cercanos
+compr::busqueda busqueda;
+
+// Codigo con el que se guardan los indices de bloque
+compr::tipo_codigo codigo = compr::codigo_huffman;
+
+// Como se guardan los pixels de los bloques guardados
+compr::tipo_guardados guardados = compr::guardados_crudos;
+
 void zip(const char *image, const char *out, double alpha, unsigned p, unsigned q);
 void unzip(const char *in, const char *out);
+void bench(const char *image, double alpha, unsigned p, unsigned q, bool todos);
+U32 leer_hilos(const string &opcion, const string &valor);
 
 int main(int argc, char **argv)
 {
+	// Separamos las opciones (--nombre=valor) de los argumentos posicionales
+	vector<char*> args;
+	bool medir = false, indiceFijado = false;
+	for (int i = 0; i < argc; ++i) {
+		string arg = argv[i];
+
+		if (arg.compare(0, 6, "--isa=") == 0) {
+			// Fuerza una version de los nucleos de calculo, para medir o depurar
+			if (!cpu::seleccionar(arg.substr(6).c_str())) {
+				cout << "Unknown or unsupported ISA: " << arg.substr(6)
+					 << " (best supported: " << cpu::nombre(cpu::detectar()) << ")" << endl;
+				exit(1);
+			}
+		}
+		else if (arg.compare(0, 8, "--index=") == 0) {
+			if (!compr::por_nombre(arg.substr(8).c_str(), busqueda.indice)) {
+				cout << "Unknown index: " << arg.substr(8) << endl;
+				exit(1);
+			}
+			indiceFijado = true;
+		}
+		else if (arg.compare(0, 12, "--max-evals=") == 0) {
+			busqueda.max_evaluaciones = atoi(arg.substr(12).c_str());
+		}
+		else if (arg.compare(0, 10, "--threads=") == 0) {
+			busqueda.hilos = leer_hilos("--threads", arg.substr(10));
+		}
+		else if (arg.compare(0, 8, "--bands=") == 0) {
+			busqueda.bandas = leer_hilos("--bands", arg.substr(8));
+		}
+		else if (arg.compare(0, 10, "--rebuild=") == 0) {
+			busqueda.reconstruir = atof(arg.substr(10).c_str());
+		}
+		else if (arg.compare(0, 10, "--entropy=") == 0) {
+			if (!compr::por_nombre(arg.substr(10).c_str(), codigo)) {
+				cout << "Unknown entropy coder: " << arg.substr(10) << endl;
+				exit(1);
+			}
+		}
+		else if (arg.compare(0, 11, "--codebook=") == 0) {
+			if (!compr::por_nombre(arg.substr(11).c_str(), guardados)) {
+				cout << "Unknown codebook format: " << arg.substr(11) << endl;
+				exit(1);
+			}
+		}
+		else if (arg == "--batch") busqueda.lotes = true;
+		else if (arg == "--bench") medir = true;
+		else if (i > 0 && arg.compare(0, 2, "--") == 0) {
+			cout << "Unknown option: " << arg << endl;
+			exit(1);
+		}
+		else args.push_back(argv[i]);
+	}
+	argc = args.size();
+	argv = &args[0];
+
 	if (argc < 2 || argc > 6) {
-		cout << "Usage: " << argv[0] << " <input file> [output file] [p] [q] [alpha]" << endl;
+		cout << "Usage: " << argv[0] << " [options] <input file> [output file] [p] [q] [alpha]" << endl;
+		cout << "Options:" << endl;
+		cout << "  --isa=scalar|sse2|sse4.1|avx2|avx512   Force the kernels for an instruction set" << endl;
+		cout << "  --index=ght|vpt|laesa                  Index used to search for similar blocks" << endl;
+		cout << "  --max-evals=N                          Stop each block search after N distances" << endl;
+		cout << "  --threads=N                            Search for similar blocks with N threads" << endl;
+		cout << "  --bands=N                              Encode N horizontal bands in parallel, then merge" << endl;
+		cout << "  --batch                                Search in batches also with one thread (same output)" << endl;
+		cout << "  --rebuild=F                            Rebuild the GHT or VP-tree when its depth exceeds F*log2(size)" << endl;
+		cout << "  --entropy=huffman|rans                 Entropy coder for the block indices" << endl;
+		cout << "  --codebook=raw|predict                 Store the stored blocks raw or predicted and entropy coded" << endl;
+		cout << "  --bench                                Compress with each index and report, without writing" << endl;
 		exit(1);
 	}
 
@@ -32,6 +113,11 @@ int main(int argc, char **argv)
 	if (argc > 4) q = atoi(argv[4]);
 	if (argc > 3) p = atoi(argv[3]);
 
+	if (medir) {
+		bench(argv[1], alpha, p, q, !indiceFijado);
+		return 0;
+	}
+
 	// Cierto si el programa debe comprimir, falso en caso contrario.
 	bool compress = false;
 
@@ -61,20 +147,43 @@ int main(int argc, char **argv)
 	}
 }
 
+// Numero de hilos (o de bandas, que van cada una en su hilo) de la opcion dada. Tiene que ser
+// un entero de 1 a 4 veces los hilos del procesador; si no, el programa termina con un error.
+U32 leer_hilos(const string &opcion, const string &valor)
+{
+	long maximo = 4 * max(1u, thread::hardware_concurrency());
+
+	char *fin;
+	long n = strtol(valor.c_str(), &fin, 10);
+	if (valor.empty() || *fin != 0 || n < 1 || n > maximo) {
+		cout << "Invalid " << opcion << ": " << valor << " (must be between 1 and " << maximo << ")" << endl;
+		exit(1);
+	}
+	return (U32) n;
+}
+
 void zip(const char *image, const char *out, double alpha, unsigned p, unsigned q)
 {
 	// Leemos imagen
 	PPM img = io::read_ppm(image);
 
-	// Ejecutamos la compresion
-	pair<void*, size_t> muzip_blob = compr::muzip(img, alpha, p, q);
+	// Ejecutamos la compresion. Con un maximo de distancias por busqueda se recogen las
+	// estadisticas, para decir cuantas busquedas llegaron a el.
+	compr::estadisticas est;
+	compr::estadisticas *pest = busqueda.max_evaluaciones > 0 ? &est : 0;
+	pair<void*, size_t> muzip_blob = compr::muzip(img, alpha, p, q, busqueda, pest, codigo, guardados);
 	
 	// Escribir blob en archivo
 	fstream f(out, fstream::out | fstream::binary);
 	f.write((const char*)muzip_blob.first, muzip_blob.second);
 	f.close();
+
+	if (pest) {
+		cout << out << ": " << est.agotadas << " capped searches (max " << busqueda.max_evaluaciones
+			 << " distances), " << est.guardados << " stored blocks" << endl;
+	}
 	
-	delete[] muzip_blob.first;
+	delete[] (I8*) muzip_blob.first;
 }
 
 void unzip(const char *in, const char *out)
@@ -87,9 +196,72 @@ void unzip(const char *in, const char *out)
 	f.read((char*)data, s);
 	f.close();
 
-	PPM result = compr::muunzip(data, s);
+	// Los errores de formato llegan como excepciones con un mensaje
+	try {
+		PPM result = compr::muunzip(data, s);
+		io::write_ppm(result, out);
+	}
+	catch (const char *error) {
+		cout << in << ": " << error << endl;
+		delete[] data;
+		exit(1);
+	}
 
-	io::write_ppm(result, out);
-	
 	delete[] data;
 }
+
+// Destino que reutiliza el mismo buffer en todas las compresiones
+struct buffer : compr::destino {
+	vector<U8> datos;
+
+	U8* reservar(size_t tam)
+	{
+		if (datos.size() < tam) datos.resize(tam);
+		return &datos[0];
+	}
+};
+
+void bench(const char *image, double alpha, unsigned p, unsigned q, bool todos)
+{
+	PPM img = io::read_ppm(image);
+	buffer buf;
+
+	// Sin --index se prueban todos los indices
+	int primero = todos ? 0 : busqueda.indice;
+	int ultimo = todos ? compr::num_indices - 1 : busqueda.indice;
+
+	for (int k = primero; k <= ultimo; ++k) {
+		compr::busqueda b = busqueda;
+		b.indice = (compr::tipo_indice) k;
+		compr::estadisticas est;
+
+		// Con bandas se compara el tamano con el que se obtiene sin ellas
+		size_t referencia = 0;
+		if (b.bandas > 1) {
+			compr::busqueda serie = b;
+			serie.bandas = 1;
+			referencia = compr::muzip(img, alpha, p, q, buf, serie, 0, codigo, guardados);
+		}
+
+		chrono::steady_clock::time_point inicio = chrono::steady_clock::now();
+		size_t tam = compr::muzip(img, alpha, p, q, buf, b, &est, codigo, guardados);
+		chrono::duration<double> segundos = chrono::steady_clock::now() - inicio;
+
+		cout << image << "\t" << compr::nombre(b.indice)
+			 << "\t" << segundos.count() << " s"
+			 << "\t" << est.evaluaciones << " distances"
+			 << "\t" << est.guardados << " stored blocks"
+			 << "\t" << est.exactos << " exact repeats"
+			 << "\t" << est.agotadas << " capped searches"
+			 << "\t" << est.repetidas << " repeated searches"
+			 << "\t" << est.profundidad << " max depth"
+			 << "\t" << est.profundidad_media << " mean depth"
+			 << "\t" << est.reconstrucciones << " rebuilds"
+			 << "\t" << tam << " bytes";
+		if (b.bandas > 1) {
+			cout << "\t" << est.fusionados << " merged blocks"
+				 << "\t" << 100.0 * ((double) tam / referencia - 1) << "% larger than 1 band";
+		}
+		cout << endl;
+	}
+}
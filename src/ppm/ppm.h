@@ -3,6 +3,20 @@
 
 #include "types.h"
 #include <boost/shared_array.hpp>
+#include <cstdlib>
+
+/// Pixel de una imagen ppm, con el mismo formato que tiene en el buffer de datos.
+struct rgb {
+	U8 r, g, b;
+};
+
+/// Distancia entre pixeles: media de las diferencias absolutas de cada componente.
+inline double operator- (const rgb& a, const rgb& b)
+{
+	return	(	std::abs(a.r - b.r) +
+				std::abs(a.g - b.g) +
+				std::abs(a.b - b.b)		) / 3.0;
+}
 
 /// Estructura para almacenar una imagen ppm.
 class PPM
@@ -32,6 +46,10 @@ public:
 	/// Devuelve el componente b del pixel (i,j).
 	U8 b (int i, int j) const { return data[(i*w + j)*3 + 2]; }
 	
+	/// Devuelve los pixels de la imagen, contiguos y ordenados por filas.
+	/// Permite recorrer la imagen sin pasar por los accesores de cada componente.
+	rgb* pixels() const { return (rgb*) data.get(); }
+
 	/// Devuelve la anchura en pixels de la imagen.
 	int width() const { return w; }
 	
@@ -0,0 +1,541 @@
+#include "rans.h"
+#include "huffman/HuffmanCode.hpp"
+#include <algorithm>
+
+using namespace rans;
+
+// Formato del bloque:
+// U32 n:             numero de simbolos.
+// U8  scale:         las frecuencias suman 2^scale.
+// U8  dense:         1 si la tabla es densa (ver huffman::dense_table), 0 si no.
+// Si no es densa:
+// U32 k:             numero de elementos en el alfabeto.
+// U32 x k:           el alfabeto, en orden creciente.
+// varint x k:        2*f si el elemento tiene frecuencia propia f, o 2*c + 1 si va en la clase c.
+// Si es densa:
+// U32 m:             el mayor elemento del alfabeto mas 1.
+// varint x m:        como el anterior, para cada valor de 0 a m-1, o 0 si no esta en el alfabeto.
+// Despues:
+// U8  C:             numero de clases.
+// U16 x C:           frecuencia de cada clase (0 si no tiene elementos).
+// U32 nwords:        palabras de 16 bits del flujo.
+// U32 x lanes:       estados con los que empieza el decodificador.
+// U16 x nwords:      el flujo, en el orden en que lo lee el decodificador.
+//
+// El simbolo i se codifica con el estado i % lanes. Los elementos demasiado raros para tener
+// frecuencia propia se agrupan en clases por el logaritmo de sus apariciones y comparten la
+// frecuencia de su clase: tras ella se codifica la posicion del elemento entre los de la clase,
+// con probabilidad uniforme y en trozos de hasta 16 bits. Como los de una clase aparecen mas o
+// menos las mismas veces, se pierde poco respecto a darles frecuencia propia.
+
+namespace {
+
+/// Bits de precision de las frecuencias. Con mas bits hay sitio para mas elementos con
+/// frecuencia propia, pero la tabla del decodificador es mayor. Las frecuencias se guardan en
+/// 16 bits, asi que su suma tampoco puede pasar de 2^15.
+const int min_scale = 12;
+const int max_scale = 15;
+
+/// Estados entrelazados.
+const int lanes = 4;
+
+/// Cota inferior de los estados, que estan en [L, 2^32). Se leen y escriben de 16 en 16 bits.
+const U32 L = 1u << 16;
+
+
+/// Codifica en x el simbolo con frecuencia acumulada cum y frecuencia freq, sobre 2^scale.
+/// Antes, si x no cabria, saca sus 16 bits bajos a words. Pre: scale <= 16
+inline void put (U32& x, std::vector<U16>& words, U32 cum, U32 freq, int scale)
+{
+	U64 x_max = ((U64) (L >> scale) << 16) * freq;
+	if (x >= x_max)
+	{
+		words.push_back((U16) x);
+		x >>= 16;
+	}
+	x = ((x / freq) << scale) + (x % freq) + cum;
+}
+
+
+/// Lee un valor de tipo T del blob dado, sin requisitos de alineamiento.
+/// Retorna la nueva posicion en el blob.
+template <class T>
+const U8* read_num (const U8* ptr, T& val)
+{
+	memcpy(&val, ptr, sizeof(T));
+	return ptr + sizeof(T);
+}
+
+
+/// Escribe un valor de tipo T en el blob dado, sin requisitos de alineamiento.
+/// Retorna la nueva posicion en el blob.
+template <class T>
+U8* write_num (U8* ptr, T val)
+{
+	memcpy(ptr, &val, sizeof(T));
+	return ptr + sizeof(T);
+}
+
+
+/// Bytes que ocupa v escrito con write_varint.
+inline size_t varint_size (U32 v)
+{
+	size_t s = 1;
+	for (; v >= 0x80; v >>= 7) ++s;
+	return s;
+}
+
+
+/// Escribe v de 7 en 7 bits, los bajos primero. El bit alto de cada byte indica si sigue otro.
+/// Retorna la nueva posicion en el blob.
+inline U8* write_varint (U8* ptr, U32 v)
+{
+	for (; v >= 0x80; v >>= 7) *ptr++ = (U8) (v | 0x80);
+	*ptr++ = (U8) v;
+	return ptr;
+}
+
+
+/// Lee un valor escrito con write_varint, sin pasar de end.
+/// Retorna la nueva posicion en el blob.
+inline const U8* read_varint (const U8* ptr, const U8* end, U32& v)
+{
+	v = 0;
+	for (int shift = 0; ptr < end && shift < 32; shift += 7)
+	{
+		U8 b = *ptr++;
+		v |= (U32) (b & 0x7f) << shift;
+		if (!(b & 0x80)) return ptr;
+	}
+	throw "rans: truncated header";
+}
+
+
+/// Bits con los que se codifica una posicion entre e elementos.
+inline int rank_bits (U32 e)
+{
+	int b = 0;
+	while (((U64) 1 << b) < e) ++b;
+	return b;
+}
+
+
+/// Bits de precision para k elementos: con 2^scale al menos 8 veces k, para que el redondeo de
+/// las frecuencias pierda poco, entre min_scale y max_scale.
+inline int choose_scale (U32 k)
+{
+	int scale = min_scale;
+	while (scale < max_scale && ((U64) 1 << (scale - 3)) < k) ++scale;
+	return scale;
+}
+
+
+/// Reparte 2^scale entre los pesos dados, en proporcion a ellos y con al menos 1 para cada uno.
+/// Pre: 0 < weights.size() <= 2^scale, pesos no nulos que suman n
+void quantize (const std::vector<U64>& weights, U64 n, int scale, std::vector<U16>& freqs)
+{
+	U64 total = (U64) 1 << scale;
+	size_t k = weights.size();
+	std::vector<U32> order(k);
+	for (size_t i = 0; i < k; ++i) order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&weights](U32 a, U32 b) { return weights[a] > weights[b]; });
+
+	freqs.resize(k);
+	U64 sum = 0;
+	for (size_t i = 0; i < k; ++i)
+	{
+		U64 f = weights[i] * total / n;
+		freqs[i] = f > 1 ? f : 1;
+		sum += freqs[i];
+	}
+
+	// Lo que falta se lo lleva el mas pesado, y lo que sobra se quita de los mas pesados sin
+	// dejar ninguno a 0
+	if (sum < total) freqs[order[0]] += total - sum;
+	for (size_t j = 0; sum > total && j < k; ++j)
+	{
+		U16& f = freqs[order[j]];
+		U64 d = std::min<U64>(sum - total, f - 1);
+		f -= d;
+		sum -= d;
+	}
+}
+
+
+/// Modelo de un bloque: con que frecuencia se codifica cada elemento del alfabeto.
+struct model
+{
+	int scale;
+
+	/// Frecuencia propia de cada elemento, o 0 si va en su clase.
+	std::vector<U16> freqs;
+
+	/// Clase de cada elemento sin frecuencia propia.
+	std::vector<U8> classes;
+
+	/// Frecuencia de cada clase.
+	std::vector<U16> class_freqs;
+};
+
+
+/// Codigo de la tabla para el elemento i del modelo: 2*f si tiene frecuencia propia f, o
+/// 2*c + 1 si va en la clase c. Nunca es 0, que en la tabla densa marca los valores que faltan.
+inline U32 table_code (const model& md, U32 i)
+{
+	return md.freqs[i] ? 2 * md.freqs[i] : 2 * md.classes[i] + 1;
+}
+
+
+/// Construye el modelo de los elementos con las apariciones dadas en una secuencia de n.
+/// Tienen frecuencia propia los que aparecen al menos una vez cada 2^scale simbolos, hasta la
+/// mitad de 2^scale de los mas frecuentes para que el redondeo no robe demasiada probabilidad
+/// a los demas, y los demas van en la clase del logaritmo de sus apariciones. Pre: n > 0
+void build_model (const std::vector<U32>& counts, U64 n, model& md)
+{
+	size_t k = counts.size();
+	md.scale = choose_scale(k);
+	U64 total = (U64) 1 << md.scale;
+
+	std::vector<U32> order(k);
+	for (size_t i = 0; i < k; ++i) order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&counts](U32 a, U32 b) { return counts[a] > counts[b]; });
+
+	size_t m = 0;
+	while (m < k && m < total / 2 && (U64) counts[order[m]] * total >= n) ++m;
+
+	md.classes.assign(k, 0);
+	std::vector<U64> class_counts;
+	for (size_t j = m; j < k; ++j)
+	{
+		U32 c = rank_bits(counts[order[j]] + 1) - 1;
+		md.classes[order[j]] = c;
+		if (c >= class_counts.size()) class_counts.resize(c + 1, 0);
+		class_counts[c] += counts[order[j]];
+	}
+
+	// 2^scale se reparte entre los elementos con frecuencia propia y las clases con elementos
+	std::vector<U64> weights;
+	for (size_t j = 0; j < m; ++j) weights.push_back(counts[order[j]]);
+	for (size_t c = 0; c < class_counts.size(); ++c) if (class_counts[c]) weights.push_back(class_counts[c]);
+
+	std::vector<U16> f;
+	quantize(weights, n, md.scale, f);
+
+	md.freqs.assign(k, 0);
+	for (size_t j = 0; j < m; ++j) md.freqs[order[j]] = f[j];
+	md.class_freqs.assign(class_counts.size(), 0);
+	for (size_t c = 0, w = m; c < class_counts.size(); ++c) if (class_counts[c]) md.class_freqs[c] = f[w++];
+}
+
+
+/// Entrada de la tabla del decodificador para cada valor de x mod 2^scale: el simbolo cuya
+/// frecuencia acumulada cubre ese valor (un elemento, o una clase si esta en la parte de las
+/// clases), su frecuencia y la diferencia entre el valor y la frecuencia acumulada.
+struct slot
+{
+	U32 value;
+	U16 freq;
+	U16 bias;
+};
+
+
+/// Decodificador de un bloque: la tabla de simbolos y el flujo.
+class Decoder
+{
+	std::vector<slot> table;
+
+	/// Bits de precision de las frecuencias.
+	int scale;
+
+	/// Primer valor de la tabla que corresponde a una clase.
+	U32 class_start;
+
+	/// Elementos de cada clase, en orden creciente, y bits de su posicion en ella.
+	std::vector< std::vector<U32> > members;
+	std::vector<int> bits;
+
+	const U16* words;
+	const U16* end;
+
+	/// Lleva x de vuelta a [L, 2^32) si ha bajado de L.
+	void renorm (U32& x)
+	{
+		if (x < L)
+		{
+			if (words == end) throw "rans: truncated stream";
+			x = (x << 16) | *words++;
+		}
+	}
+
+	/// Decodifica un valor de b bits con probabilidad uniforme. Pre: 0 < b <= 16
+	U32 raw (U32& x, int b)
+	{
+		U32 v = x & ((1u << b) - 1);
+		x >>= b;
+		renorm(x);
+		return v;
+	}
+
+	/// Decodifica con el estado x el simbolo siguiente.
+	U32 symbol (U32& x)
+	{
+		U32 s = x & ((1u << scale) - 1);
+		const slot& e = table[s];
+		x = e.freq * (x >> scale) + e.bias;
+		renorm(x);
+		if (s < class_start) return e.value;
+
+		// Tras la clase va la posicion en ella, los bits altos primero
+		U32 c = e.value;
+		U32 rank = 0;
+		for (int b = bits[c]; b > 0;)
+		{
+			int t = b > 16 ? 16 : b;
+			rank = (rank << t) | raw(x, t);
+			b -= t;
+		}
+		if (rank >= members[c].size()) throw "rans: invalid symbol";
+		return members[c][rank];
+	}
+
+public:
+
+	/// Construye la tabla de los elementos dados con el modelo dado, para leer el flujo de
+	/// palabras [w, e).
+	/// O(k + 2^scale)
+	Decoder (const std::vector<U32>& alphabet, const model& md, const U16* w, const U16* e)
+		: scale(md.scale), words(w), end(e)
+	{
+		U32 total = 1u << scale;
+		U32 cum = 0;
+		table.resize(total);
+		members.resize(md.class_freqs.size());
+		for (size_t i = 0; i < alphabet.size(); ++i)
+		{
+			U32 f = md.freqs[i];
+			if (f == 0)
+			{
+				members[md.classes[i]].push_back(alphabet[i]);
+				continue;
+			}
+			if (cum + f > total) throw "rans: invalid frequencies";
+			for (U32 j = 0; j < f; ++j)
+			{
+				slot s = { alphabet[i], (U16) f, (U16) j };
+				table[cum + j] = s;
+			}
+			cum += f;
+		}
+
+		class_start = cum;
+		bits.resize(members.size());
+		for (size_t c = 0; c < members.size(); ++c)
+		{
+			U32 f = md.class_freqs[c];
+			if (members[c].empty() != (f == 0) || cum + f > total) throw "rans: invalid frequencies";
+			for (U32 j = 0; j < f; ++j)
+			{
+				slot s = { (U32) c, (U16) f, (U16) j };
+				table[cum + j] = s;
+			}
+			cum += f;
+			bits[c] = rank_bits(members[c].size());
+		}
+		if (cum != total) throw "rans: invalid frequencies";
+	}
+
+	/// Decodifica n simbolos con los estados x y los anade a cont.
+	/// O(n)
+	void decode (U32* x, U32 n, std::vector<U32>& cont)
+	{
+		size_t base = cont.size();
+		cont.resize(base + n);
+		U32* out = &cont[0] + base;
+
+		// Los estados no dependen unos de otros, asi que sus pasos se pueden solapar
+		U32 i = 0;
+		for (; i + lanes <= n; i += lanes)
+		{
+			out[i]     = symbol(x[0]);
+			out[i + 1] = symbol(x[1]);
+			out[i + 2] = symbol(x[2]);
+			out[i + 3] = symbol(x[3]);
+		}
+		for (; i < n; ++i) out[i] = symbol(x[i % lanes]);
+
+		// El codificador empieza con todos los estados en L y no deja palabras sin leer
+		for (int j = 0; j < lanes; ++j) if (x[j] != L) throw "rans: corrupt stream";
+		if (words != end) throw "rans: corrupt stream";
+	}
+};
+
+} // namespace
+
+
+std::pair<void*,size_t> rans::encode (const U32* begin, const U32* end)
+{
+	U32 n = end - begin;
+
+	std::vector<U32> alphabet;
+	std::vector<U32> counts;
+	huffman::count_symbols ((U32*) begin, (U32*) end, alphabet, counts);
+	U32 k = alphabet.size();
+
+	model md;
+	md.scale = min_scale;
+	if (n > 0) build_model (counts, n, md);
+	U32 nclasses = md.class_freqs.size();
+
+	// Frecuencia acumulada de cada elemento con frecuencia propia y de cada clase, en el mismo
+	// orden que el decodificador, y posicion en su clase de los demas
+	std::vector<U32> cums(k);
+	std::vector<U32> class_cums(nclasses), class_sizes(nclasses, 0);
+	U32 cum = 0;
+	for (U32 i = 0; i < k; ++i)
+	{
+		if (md.freqs[i] > 0)	{ cums[i] = cum; cum += md.freqs[i]; }
+		else					{ cums[i] = class_sizes[md.classes[i]]++; }
+	}
+	std::vector<int> bits(nclasses);
+	for (U32 c = 0; c < nclasses; ++c)
+	{
+		class_cums[c] = cum;
+		cum += md.class_freqs[c];
+		bits[c] = rank_bits (class_sizes[c]);
+	}
+
+	// Posicion de cada valor en el alfabeto: en un array si los valores son densos, y si no,
+	// buscandola en el propio alfabeto, que esta ordenado
+	bool dense = k > 0 && huffman::dense (alphabet.back(), n);
+	std::vector<U32> index;
+	if (dense)
+	{
+		index.resize(alphabet.back() + 1);
+		for (U32 i = 0; i < k; ++i) index[alphabet[i]] = i;
+	}
+
+	// rANS codifica al reves: los simbolos se recorren del ultimo al primero, y los de una
+	// clase, de los bits bajos de su posicion a la clase
+	U32 x[lanes];
+	for (int j = 0; j < lanes; ++j) x[j] = L;
+	std::vector<U16> words;
+	words.reserve(n / 2 + 16);
+	for (U32 i = n; i-- > 0;)
+	{
+		U32& xs = x[i % lanes];
+		U32 a = dense ? index[begin[i]] : std::lower_bound(alphabet.begin(), alphabet.end(), begin[i]) - alphabet.begin();
+		if (md.freqs[a] > 0)
+		{
+			put (xs, words, cums[a], md.freqs[a], md.scale);
+			continue;
+		}
+
+		U32 c = md.classes[a];
+		int b = bits[c] % 16 ? bits[c] % 16 : 16;
+		for (int done = 0; done < bits[c]; done += b, b = 16)
+		{
+			put (xs, words, (cums[a] >> done) & ((1u << b) - 1), 1, b);
+		}
+		put (xs, words, class_cums[c], md.class_freqs[c], md.scale);
+	}
+	std::reverse(words.begin(), words.end());
+
+	// En la tabla densa los valores que faltan ocupan un byte, y el alfabeto no se guarda
+	bool dense_tab = huffman::dense_table (alphabet);
+	U32 m = dense_tab ? alphabet.back() + 1 : k;
+	size_t s = 4 + 1 + 1 + 4 + 1 + 2 * nclasses + 4 + 4 * lanes + 2 * words.size();
+	s += dense_tab ? m - k : 4 * (size_t) k;
+	for (U32 i = 0; i < k; ++i) s += varint_size (table_code (md, i));
+
+	U8* buf = new U8[s];
+	U8* ptr = buf;
+	ptr = write_num<U32> (ptr, n);
+	ptr = write_num<U8> (ptr, md.scale);
+	ptr = write_num<U8> (ptr, dense_tab);
+	ptr = write_num<U32> (ptr, m);
+	if (dense_tab)
+	{
+		for (U32 v = 0, i = 0; v < m; ++v) ptr = write_varint (ptr, alphabet[i] == v ? table_code (md, i++) : 0);
+	}
+	else
+	{
+		if (k > 0)
+		{
+			memcpy (ptr, &alphabet[0], 4 * (size_t) k);
+			ptr += 4 * (size_t) k;
+		}
+		for (U32 i = 0; i < k; ++i) ptr = write_varint (ptr, table_code (md, i));
+	}
+	ptr = write_num<U8> (ptr, nclasses);
+	for (U32 c = 0; c < nclasses; ++c) ptr = write_num<U16> (ptr, md.class_freqs[c]);
+	ptr = write_num<U32> (ptr, words.size());
+	for (int j = 0; j < lanes; ++j) ptr = write_num<U32> (ptr, x[j]);
+	if (!words.empty()) memcpy (ptr, &words[0], 2 * words.size());
+
+	return std::make_pair (buf, s);
+}
+
+
+void rans::decode (const void* blob, size_t size, std::vector<U32>& cont, size_t max)
+{
+	const U8* ptr = (const U8*) blob;
+	const U8* end = ptr + size;
+
+	U32 n, k;
+	U8 scale, dense_tab;
+	if (size < 10) throw "rans: truncated header";
+	ptr = read_num<U32> (ptr, n);
+	ptr = read_num<U8> (ptr, scale);
+	ptr = read_num<U8> (ptr, dense_tab);
+	ptr = read_num<U32> (ptr, k);
+	if (scale < min_scale || scale > max_scale) throw "rans: unsupported scale";
+	if (dense_tab > 1 || n > max) throw "rans: invalid header";
+
+	// Cada elemento de la tabla ocupa al menos un byte, y si no es densa cuatro mas
+	if ((size_t) (end - ptr) < (dense_tab ? 1 : 5) * (size_t) k) throw "rans: truncated header";
+
+	std::vector<U32> alphabet;
+	if (!dense_tab && k > 0)
+	{
+		alphabet.resize(k);
+		memcpy (&alphabet[0], ptr, 4 * (size_t) k);
+		ptr += 4 * (size_t) k;
+	}
+
+	model md;
+	md.scale = scale;
+	int max_class = -1;
+	for (U32 i = 0; i < k; ++i)
+	{
+		U32 v;
+		ptr = read_varint (ptr, end, v);
+		if (dense_tab && v == 0) continue;
+		if (v == 0 || v / 2 > (v % 2 ? 0xff : 0xffff)) throw "rans: invalid header";
+		if (dense_tab) alphabet.push_back(i);
+		md.freqs.push_back(v % 2 ? 0 : v / 2);
+		md.classes.push_back(v % 2 ? v / 2 : 0);
+		if (v % 2) max_class = std::max(max_class, (int) (v / 2));
+	}
+
+	U8 nclasses;
+	if (end - ptr < 1) throw "rans: truncated header";
+	ptr = read_num<U8> (ptr, nclasses);
+	if (max_class >= nclasses) throw "rans: invalid header";
+	if ((size_t) (end - ptr) < 2 * (size_t) nclasses + 4 + 4 * lanes) throw "rans: truncated header";
+	md.class_freqs.resize(nclasses);
+	for (U32 c = 0; c < nclasses; ++c) ptr = read_num<U16> (ptr, md.class_freqs[c]);
+
+	U32 nwords;
+	U32 x[lanes];
+	ptr = read_num<U32> (ptr, nwords);
+	for (int j = 0; j < lanes; ++j) ptr = read_num<U32> (ptr, x[j]);
+	if ((size_t) (end - ptr) < 2 * (size_t) nwords) throw "rans: truncated stream";
+	if (n == 0) return;
+
+	// El flujo se copia para leerlo alineado
+	std::vector<U16> words(nwords);
+	if (nwords > 0) memcpy (&words[0], ptr, 2 * (size_t) nwords);
+
+	Decoder d(alphabet, md, words.empty() ? 0 : &words[0], words.empty() ? 0 : &words[0] + nwords);
+	d.decode (x, n, cont);
+}
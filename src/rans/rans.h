@@ -0,0 +1,25 @@
+#ifndef _RANS_H
+#define _RANS_H
+
+#include <utility>
+#include <vector>
+#include <cstring> // size_t
+#include "../types.h"
+
+/// API Publica.
+namespace rans {
+
+/// Codifica la secuencia de enteros dada con rANS. Los simbolos se reparten entre varios
+/// estados que se codifican entrelazados en un solo flujo, asi que al decodificar cada estado
+/// avanza sin esperar a los demas.
+/// O(n + k) con valores densos, donde k es el mayor valor de la secuencia.
+std::pair<void*,size_t> encode (const U32* begin, const U32* end);
+
+/// Decodifica el bloque dado y anade los simbolos a cont. Lanza una excepcion si el bloque
+/// dice tener mas de max simbolos, antes de reservar sitio para ellos.
+/// O(n)
+void decode (const void* blob, size_t size, std::vector<U32>& cont, size_t max);
+
+} // namespace rans end
+
+#endif // _RANS_H
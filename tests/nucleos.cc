@@ -0,0 +1,170 @@
+#include "cpu/cpu.h"
+#include "dist/bloqdist.hpp"
+#include "Matriz.hpp"
+#include "ppm/ppm.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// Compara los nucleos de cada juego de instrucciones que soporta el procesador con los
+// escalares, que son la referencia. Los bloques se toman de imagenes de ancho y posicion
+// aleatorios, con los tamanos especializados (ver nucleos_comunes.h) y otros cualquiera.
+// Tambien compara la distancia entre bloques de imagen de dist::bloqdist, que usa el nucleo
+// SAD, con la formula original, pixel a pixel.
+
+namespace {
+
+// Generador congruencial, para que las pruebas se repitan igual en cualquier plataforma
+U32 semilla = 12345;
+
+U32 aleatorio(U32 n)
+{
+	semilla = semilla * 1103515245u + 12345u;
+	return (semilla >> 8) % n;
+}
+
+int fallos = 0;
+
+void fallo(cpu::isa i, const char *nucleo, int filas, int ancho, size_t paso, U32 esperado, U32 obtenido)
+{
+	if (++fallos <= 20) {
+		printf("%s: %s de %dx%d bytes (paso %u): %u en vez de %u\n", cpu::nombre(i), nucleo,
+			   filas, ancho, (unsigned) paso, obtenido, esperado);
+	}
+}
+
+// Tamanos en pixels RGB (3 bytes): 4, 8 y 16 como los nucleos especializados, y otros impares
+const int tamanos[][2] = { { 4, 4 }, { 8, 8 }, { 16, 16 }, { 1, 1 }, { 3, 5 }, { 5, 3 },
+						   { 7, 9 }, { 8, 4 }, { 4, 8 }, { 13, 11 }, { 16, 7 }, { 2, 33 } };
+const int num_tamanos = sizeof(tamanos) / sizeof(tamanos[0]);
+
+void probar_bloques(cpu::isa i)
+{
+	const cpu::nucleos &ref = cpu::nucleos_escalar, &n = cpu::nucleo;
+
+	for (int t = 0; t < num_tamanos; ++t) {
+		int filas = tamanos[t][0], ancho = 3 * tamanos[t][1];
+
+		for (int r = 0; r < 200; ++r) {
+			// Imagen con un ancho cualquiera mayor que el del bloque, y dos bloques suyos en
+			// posiciones aleatorias, sin alinear
+			size_t paso = ancho + aleatorio(64);
+			std::vector<U8> img(paso * (2 * filas + aleatorio(4)) + 64);
+			// Con pocos valores distintos hay bloques iguales o casi, y se prueban SAD pequenas
+			U32 rango = r % 4 == 0 ? 4 : 256;
+			for (size_t k = 0; k < img.size(); ++k) img[k] = (U8) aleatorio(rango);
+
+			const U8 *a = &img[aleatorio((U32) (img.size() - paso * (filas - 1) - ancho))];
+			const U8 *b = &img[aleatorio((U32) (img.size() - paso * (filas - 1) - ancho))];
+
+			U32 s = ref.sad(a, b, paso, filas, ancho);
+			U32 x = n.sad(a, b, paso, filas, ancho);
+			if (x != s) fallo(i, "sad", filas, ancho, paso, s, x);
+
+			// Limites por debajo, en y por encima de la SAD
+			U32 limites[] = { 0, s / 2, s ? s - 1 : 0, s, s + 1, aleatorio(s + 1), 0xffffffff };
+			for (size_t l = 0; l < sizeof(limites) / sizeof(limites[0]); ++l) {
+				U32 y = n.sad_acotada(a, b, paso, filas, ancho, limites[l]);
+				bool bien = s <= limites[l] ? y == s : y > limites[l] && y <= s;
+				if (!bien) fallo(i, "sad_acotada", filas, ancho, paso, s, y);
+			}
+
+			// Copia a un destino con otro paso, comprobando que no se escriba fuera del bloque
+			size_t paso_dst = ancho + aleatorio(16);
+			std::vector<U8> dst(paso_dst * filas + 32, 0xa5), esperado(dst);
+			size_t desp = aleatorio(16);
+			ref.copiar(&esperado[desp], paso_dst, a, paso, filas, ancho);
+			n.copiar(&dst[desp], paso_dst, a, paso, filas, ancho);
+			if (dst != esperado) fallo(i, "copiar", filas, ancho, paso, 0, 1);
+		}
+	}
+}
+
+void probar_histograma(cpu::isa i)
+{
+	const U32 tamanos_n[] = { 0, 1, 7, 100, 4096 };
+	const U32 tamanos_k[] = { 1, 2, 16, 300 };
+
+	for (size_t a = 0; a < sizeof(tamanos_n) / sizeof(tamanos_n[0]); ++a) {
+		for (size_t b = 0; b < sizeof(tamanos_k) / sizeof(tamanos_k[0]); ++b) {
+			U32 n = tamanos_n[a], k = tamanos_k[b];
+			std::vector<U32> datos(n + 1);
+			for (U32 j = 0; j < n; ++j) datos[j] = aleatorio(k);
+
+			std::vector<U32> esperado(k, 1), cuentas(k, 1);
+			cpu::nucleos_escalar.histograma(&datos[0], n, &esperado[0], k);
+			cpu::nucleo.histograma(&datos[0], n, &cuentas[0], k);
+			if (cuentas != esperado) fallo(i, "histograma", 1, n, k, 0, 1);
+		}
+	}
+}
+
+// Distancia original entre los bloques a y b: la suma en double de la distancia de cada pixel,
+// la media de las diferencias de sus canales (operator- de rgb).
+double distancia_original(const Matriz<rgb> &m, size_t a, size_t b)
+{
+	double d = 0.0;
+	for (int i = 0; i < m.p(); ++i) {
+		for (int j = 0; j < m.q(); ++j) d += m(a, i, j) - m(b, i, j);
+	}
+	return d;
+}
+
+// dist::bloqdist es la SAD entera de los tres canales, 3 veces la distancia original salvo
+// por el redondeo de esta; dist::bloqdist_acotada cumple su contrato con esa SAD
+void probar_distancia(cpu::isa i)
+{
+	for (int t = 0; t < num_tamanos; ++t) {
+		int p = tamanos[t][0], q = tamanos[t][1];
+		int N = p * (1 + aleatorio(4)), M = q * (1 + aleatorio(5)) + aleatorio(q);
+		std::vector<rgb> img(N * M);
+		U32 rango = t % 2 ? 4 : 256;
+		for (size_t k = 0; k < img.size(); ++k) {
+			img[k].r = (U8) aleatorio(rango);
+			img[k].g = (U8) aleatorio(rango);
+			img[k].b = (U8) aleatorio(rango);
+		}
+
+		Matriz<rgb> plana(&img[0], N, M, p, q);
+		Matriz<rgb> teselada(&img[0], N, M, p, q, en_bloques());
+		const Matriz<rgb> *matrices[] = { &plana, &teselada };
+
+		for (int k = 0; k < 2; ++k) {
+			const Matriz<rgb> &m = *matrices[k];
+			for (int r = 0; r < 50; ++r) {
+				size_t a = aleatorio((U32) m.size()), b = aleatorio((U32) m.size());
+				double original = distancia_original(m, a, b);
+				double d = dist::bloqdist(m, a, b);
+				if (std::fabs(d - 3 * original) > 1e-9 * (1 + d)) {
+					fallo(i, "bloqdist", p, 3 * q, m.paso() * 3, (U32) (3 * original + 0.5), (U32) d);
+				}
+
+				double lim = aleatorio((U32) d + 2);
+				double y = dist::bloqdist_acotada(m, a, b, lim);
+				bool bien = d <= lim ? y == d : y > lim && y <= d;
+				if (!bien) fallo(i, "bloqdist_acotada", p, 3 * q, m.paso() * 3, (U32) d, (U32) y);
+			}
+		}
+	}
+}
+
+} // namespace
+
+int main()
+{
+	for (int k = 0; k < cpu::num_isas; ++k) {
+		cpu::isa i = (cpu::isa) k;
+		if (!cpu::seleccionar(i)) {
+			printf("%s: no soportado\n", cpu::nombre(i));
+			continue;
+		}
+		probar_bloques(i);
+		probar_histograma(i);
+		probar_distancia(i);
+		printf("%s: probado\n", cpu::nombre(i));
+	}
+
+	if (fallos) printf("%d fallos\n", fallos);
+	return fallos ? 1 : 0;
+}